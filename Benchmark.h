@@ -21,6 +21,52 @@ private:
         }
     }
     
+    // records wake-up latency: arg points at the QPC stamp taken at enqueue
+    static void LatencyProbeTask(void* arg) {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        LONGLONG* stamp = (LONGLONG*)arg;
+        *stamp = now.QuadPart - *stamp;
+    }
+    
+    // fork-join Fibonacci: fib(n-1) is forked as a task, fib(n-2) computed inline,
+    // then the fork is joined with Future::get() from inside the worker
+    static const int FIB_CUTOFF = 16;  // below this, recursion stays serial
+    
+    struct FibArgs {
+        TaskScheduler* scheduler;
+        int n;
+        Future<LONGLONG>* result;
+        
+        FibArgs(TaskScheduler* s, int value, Future<LONGLONG>* f) : scheduler(s), n(value), result(f) {}
+    };
+    
+    static LONGLONG serialFib(int n) {
+        return n < 2 ? n : serialFib(n - 1) + serialFib(n - 2);
+    }
+    
+    static LONGLONG parallelFib(TaskScheduler* scheduler, int n) {
+        if (n < FIB_CUTOFF) {
+            return serialFib(n);
+        }
+        
+        Future<LONGLONG>* left = new Future<LONGLONG>();
+        scheduler->enqueueTask(FibTask, new FibArgs(scheduler, n - 1, left));
+        
+        LONGLONG right = parallelFib(scheduler, n - 2);
+        LONGLONG sum = left->get() + right;  // runs other queued forks while waiting
+        delete left;
+        return sum;
+    }
+    
+    static void FibTask(void* arg) {
+        FibArgs* args = (FibArgs*)arg;
+        Future<LONGLONG>* result = args->result;
+        LONGLONG value = parallelFib(args->scheduler, args->n);
+        delete args;
+        result->setResult(value);
+    }
+    
     // get time in milliseconds
     double getTimeMs(LARGE_INTEGER start, LARGE_INTEGER end) {
         return (double)(end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
@@ -209,6 +255,141 @@ public:
         delete[] taskData;
         std::cout << std::endl;
     }
+    
+    // benchmark idle strategy - latency of tasks arriving at a quiet pool
+    void benchmarkIdleStrategies(int threadCount, int numTasks) {
+        globalLogger.info("=== BENCHMARK: Park-Only vs Spin-Then-Park ===");
+        std::cout << std::endl;
+        
+        IdleStrategy strategies[] = { IdleStrategy::parkOnly(), IdleStrategy() };
+        const char* names[] = { "Park only", "Spin-then-park" };
+        
+        LONGLONG* stamps = new LONGLONG[numTasks];
+        
+        for (int s = 0; s < 2; s++) {
+            char msg[128];
+            sprintf_s(msg, "Testing %s (%d tasks, 1 at a time)...", names[s], numTasks);
+            globalLogger.info(msg);
+            
+            {
+                TaskScheduler scheduler(threadCount, strategies[s]);
+                
+                for (int i = 0; i < numTasks; i++) {
+                    LARGE_INTEGER now;
+                    QueryPerformanceCounter(&now);
+                    stamps[i] = now.QuadPart;
+                    scheduler.enqueueTask(LatencyProbeTask, &stamps[i]);
+                    
+                    // wait for it to run so every task hits an idle pool
+                    while (scheduler.getMetrics().getPendingTasks() > 0) {
+                        SwitchToThread();
+                    }
+                }
+            }
+            
+            double totalUs = 0;
+            for (int i = 0; i < numTasks; i++) {
+                totalUs += (double)stamps[i] * 1000000.0 / frequency.QuadPart;
+            }
+            
+            sprintf_s(msg, "  Avg enqueue-to-start latency: %.2f us", totalUs / numTasks);
+            globalLogger.success(msg);
+        }
+        
+        delete[] stamps;
+        std::cout << std::endl;
+    }
+    
+    // nested fork-join (parallel Fibonacci) - every level blocks in Future::get() on a worker;
+    // with help-while-waiting it finishes on a small fixed pool instead of deadlocking
+    void benchmarkForkJoin(int threadCount, int n) {
+        globalLogger.info("=== BENCHMARK: Nested Fork-Join (parallel Fibonacci) ===");
+        std::cout << std::endl;
+        
+        char msg[160];
+        LARGE_INTEGER start, end;
+        
+        QueryPerformanceCounter(&start);
+        LONGLONG expected = serialFib(n);
+        QueryPerformanceCounter(&end);
+        double serialMs = getTimeMs(start, end);
+        
+        sprintf_s(msg, "Testing fib(%d) on %d worker threads...", n, threadCount);
+        globalLogger.info(msg);
+        
+        LONGLONG value = 0;
+        LONG forks = 0;
+        QueryPerformanceCounter(&start);
+        {
+            TaskScheduler scheduler(threadCount);
+            Future<LONGLONG> root;
+            scheduler.enqueueTask(FibTask, new FibArgs(&scheduler, n, &root));
+            value = root.get();  // main thread is not a worker - plain blocking wait
+            forks = scheduler.getMetrics().getTotalCompleted();
+        }
+        QueryPerformanceCounter(&end);
+        double parallelMs = getTimeMs(start, end);
+        
+        sprintf_s(msg, "  fib(%d) = %lld (%s) | %ld tasks | %d threads",
+                  n, value, value == expected ? "correct" : "WRONG", forks, threadCount);
+        globalLogger.success(msg);
+        sprintf_s(msg, "  Serial: %.2f ms | Parallel: %.2f ms | Speedup: %.2fx",
+                  serialMs, parallelMs, serialMs / parallelMs);
+        globalLogger.success(msg);
+        std::cout << std::endl;
+    }
+    
+    // benchmark scheduling policies on the same mixed-priority workload
+    void benchmarkPolicies(int threadCount, int numTasks) {
+        globalLogger.info("=== BENCHMARK: Scheduling Policies ===");
+        std::cout << std::endl;
+        
+        int* taskData = new int[numTasks];
+        for (int i = 0; i < numTasks; i++) {
+            taskData[i] = 10000;
+        }
+        
+        runPolicy<TaskScheduler>("Strict priority", threadCount, numTasks, taskData);
+        runPolicy<FifoTaskScheduler>("FIFO", threadCount, numTasks, taskData);
+        runPolicy<EdfTaskScheduler>("Earliest deadline first", threadCount, numTasks, taskData);
+        runPolicy<FairTaskScheduler>("Weighted fair", threadCount, numTasks, taskData);
+        
+        delete[] taskData;
+        std::cout << std::endl;
+    }
+    
+private:
+    template<typename Scheduler>
+    void runPolicy(const char* name, int threadCount, int numTasks, int* taskData) {
+        char msg[160];
+        sprintf_s(msg, "Testing %s...", name);
+        globalLogger.info(msg);
+        
+        LARGE_INTEGER start, end;
+        QueryPerformanceCounter(&start);
+        
+        double critWait = 0, lowWait = 0, lowMax = 0;
+        {
+            Scheduler scheduler(threadCount);
+            for (int i = 0; i < numTasks; i++) {
+                TaskPriority prio = (TaskPriority)(i % 4); // rotate through priorities
+                scheduler.enqueueTask(BenchmarkTask, &taskData[i], prio);
+            }
+            while (scheduler.getMetrics().getPendingTasks() > 0) {
+                Sleep(1);
+            }
+            
+            critWait = scheduler.getMetrics().getAvgQueueWaitMs(CRITICAL);
+            lowWait = scheduler.getMetrics().getAvgQueueWaitMs(LOW);
+            lowMax = scheduler.getMetrics().getMaxQueueWaitMs(LOW);
+        }
+        
+        QueryPerformanceCounter(&end);
+        
+        sprintf_s(msg, "  Time: %.2f ms | CRITICAL avg wait: %.2f ms | LOW avg/max wait: %.2f / %.2f ms",
+                  getTimeMs(start, end), critWait, lowWait, lowMax);
+        globalLogger.success(msg);
+    }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,178 @@
+#ifndef BLOCKING_POOL_H
+#define BLOCKING_POOL_H
+
+#include <windows.h>
+
+// elastic pool for tasks that block (legacy libraries, synchronous I/O)
+// a thread is started whenever work arrives and none is idle (up to maxThreads),
+// and an idle thread exits after idleTimeoutMs - so blocking work never occupies CPU workers
+// T needs 'function' and 'argument'
+template<typename T>
+class BlockingPool {
+private:
+    struct Node {
+        T data;
+        Node* next;
+        
+        Node(const T& value) : data(value), next(nullptr) {}
+    };
+    
+    Node* head;
+    Node* tail;
+    int queued;
+    
+    int maxThreads;
+    DWORD idleTimeoutMs;
+    int liveThreads;
+    int idleThreads;
+    int peakThreads;
+    LONG completed;
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE notEmpty;
+    CONDITION_VARIABLE allExited;
+    bool isShutdown;
+    
+    static DWORD WINAPI PoolThreadFunction(LPVOID param) {
+        BlockingPool* pool = (BlockingPool*)param;
+        
+        EnterCriticalSection(&pool->cs);
+        
+        while (true) {
+            if (pool->head == nullptr) {
+                if (pool->isShutdown) break;
+                
+                pool->idleThreads++;
+                BOOL woken = SleepConditionVariableCS(&pool->notEmpty, &pool->cs, pool->idleTimeoutMs);
+                pool->idleThreads--;
+                
+                // idle for the whole timeout - shrink
+                if (!woken && pool->head == nullptr) break;
+                continue;
+            }
+            
+            Node* node = pool->head;
+            pool->head = node->next;
+            if (pool->head == nullptr) {
+                pool->tail = nullptr;
+            }
+            pool->queued--;
+            
+            LeaveCriticalSection(&pool->cs);
+            
+            node->data.function(node->data.argument);
+            delete node;
+            
+            EnterCriticalSection(&pool->cs);
+            pool->completed++;
+        }
+        
+        pool->liveThreads--;
+        if (pool->liveThreads == 0) {
+            WakeAllConditionVariable(&pool->allExited);
+        }
+        
+        LeaveCriticalSection(&pool->cs);
+        return 0;
+    }
+    
+public:
+    BlockingPool(int maxThreadCount = 64, DWORD idleTimeout = 10000)
+        : head(nullptr), tail(nullptr), queued(0), maxThreads(maxThreadCount), idleTimeoutMs(idleTimeout),
+          liveThreads(0), idleThreads(0), peakThreads(0), completed(0), isShutdown(false) {
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&notEmpty);
+        InitializeConditionVariable(&allExited);
+    }
+    
+    ~BlockingPool() {
+        shutdown();
+        DeleteCriticalSection(&cs);
+    }
+    
+    void enqueue(const T& value) {
+        Node* newNode = new Node(value);
+        
+        EnterCriticalSection(&cs);
+        
+        if (tail == nullptr) {
+            head = tail = newNode;
+        } else {
+            tail->next = newNode;
+            tail = newNode;
+        }
+        queued++;
+        
+        // grow only when every thread is busy - an idle one picks this up
+        bool spawn = (queued > idleThreads && liveThreads < maxThreads);
+        if (spawn) {
+            liveThreads++;
+            if (liveThreads > peakThreads) {
+                peakThreads = liveThreads;
+            }
+        }
+        
+        LeaveCriticalSection(&cs);
+        
+        if (spawn) {
+            HANDLE thread = CreateThread(NULL, 0, PoolThreadFunction, this, 0, NULL);
+            if (thread != NULL) {
+                CloseHandle(thread);
+            } else {
+                EnterCriticalSection(&cs);
+                liveThreads--;
+                LeaveCriticalSection(&cs);
+            }
+        } else {
+            WakeConditionVariable(&notEmpty);
+        }
+    }
+    
+    // runs everything still queued, then waits for all threads to exit
+    void shutdown() {
+        EnterCriticalSection(&cs);
+        isShutdown = true;
+        WakeAllConditionVariable(&notEmpty);
+        while (liveThreads > 0) {
+            SleepConditionVariableCS(&allExited, &cs, INFINITE);
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    // cap on threads; beyond it blocking tasks queue up
+    void setMaxThreads(int count) {
+        EnterCriticalSection(&cs);
+        maxThreads = count > 0 ? count : 1;
+        LeaveCriticalSection(&cs);
+    }
+    
+    int getThreadCount() {
+        EnterCriticalSection(&cs);
+        int n = liveThreads;
+        LeaveCriticalSection(&cs);
+        return n;
+    }
+    
+    int getPeakThreads() {
+        EnterCriticalSection(&cs);
+        int n = peakThreads;
+        LeaveCriticalSection(&cs);
+        return n;
+    }
+    
+    LONG getCompleted() {
+        EnterCriticalSection(&cs);
+        LONG n = completed;
+        LeaveCriticalSection(&cs);
+        return n;
+    }
+    
+    int size() {
+        EnterCriticalSection(&cs);
+        int n = queued;
+        LeaveCriticalSection(&cs);
+        return n;
+    }
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <windows.h>
+#include <coroutine>
+#include <exception>
+#include "TaskScheduler.h"
+
+// C++20 coroutine support:
+//   CoTask<T>                        - coroutine type, result delivered through a Future<T>
+//   co_await scheduler.schedule(p)   - hop onto a TaskScheduler worker at priority p; returns
+//                                      FUTURE_READY, or why the hop was dropped (see ScheduleAwaiter)
+//   co_await *future                 - suspend until a Future<T> completes
+// coroutine frames come from a recycling pool instead of the global heap
+
+// recycling allocator for coroutine frames - lock-free free lists (SLIST) per size class
+class FramePool {
+private:
+    static const int SIZE_CLASSES = 7;    // 64, 128, ... 4096 bytes
+    static const int MIN_CLASS_SIZE = 64;
+    static const int MAX_CACHED = 1024;   // frames kept per class, the rest go back to the heap
+    static const int LARGE = -1;          // bigger than the largest class - not pooled
+    
+    // sits in front of every frame; while the block is free it holds the list link
+    union FrameHeader {
+        SLIST_ENTRY entry;
+        int sizeClass;
+    };
+    static const size_t HEADER_SIZE = (sizeof(FrameHeader) + MEMORY_ALLOCATION_ALIGNMENT - 1)
+                                      / MEMORY_ALLOCATION_ALIGNMENT * MEMORY_ALLOCATION_ALIGNMENT;
+    
+    SLIST_HEADER freeLists[SIZE_CLASSES];
+    volatile LONG allocations;
+    volatile LONG reuses;
+    
+    static int classFor(size_t size) {
+        size_t classSize = MIN_CLASS_SIZE;
+        for (int i = 0; i < SIZE_CLASSES; i++) {
+            if (size <= classSize) return i;
+            classSize *= 2;
+        }
+        return LARGE;
+    }
+    
+    static size_t classSize(int sizeClass) {
+        return (size_t)MIN_CLASS_SIZE << sizeClass;
+    }
+    
+public:
+    FramePool() : allocations(0), reuses(0) {
+        for (int i = 0; i < SIZE_CLASSES; i++) {
+            InitializeSListHead(&freeLists[i]);
+        }
+    }
+    
+    ~FramePool() {
+        for (int i = 0; i < SIZE_CLASSES; i++) {
+            PSLIST_ENTRY entry = InterlockedFlushSList(&freeLists[i]);
+            while (entry != nullptr) {
+                PSLIST_ENTRY next = entry->Next;
+                _aligned_free(entry);
+                entry = next;
+            }
+        }
+    }
+    
+    void* allocate(size_t size) {
+        InterlockedIncrement(&allocations);
+        
+        int sizeClass = classFor(size);
+        FrameHeader* header = nullptr;
+        
+        if (sizeClass != LARGE) {
+            header = (FrameHeader*)InterlockedPopEntrySList(&freeLists[sizeClass]);
+            if (header != nullptr) {
+                InterlockedIncrement(&reuses);
+            } else {
+                header = (FrameHeader*)_aligned_malloc(HEADER_SIZE + classSize(sizeClass), MEMORY_ALLOCATION_ALIGNMENT);
+            }
+        } else {
+            header = (FrameHeader*)_aligned_malloc(HEADER_SIZE + size, MEMORY_ALLOCATION_ALIGNMENT);
+        }
+        
+        if (header == nullptr) {
+            throw std::bad_alloc();
+        }
+        
+        header->sizeClass = sizeClass;
+        return (char*)header + HEADER_SIZE;
+    }
+    
+    void release(void* frame) {
+        FrameHeader* header = (FrameHeader*)((char*)frame - HEADER_SIZE);
+        int sizeClass = header->sizeClass;
+        
+        if (sizeClass != LARGE && QueryDepthSList(&freeLists[sizeClass]) < MAX_CACHED) {
+            InterlockedPushEntrySList(&freeLists[sizeClass], &header->entry);
+        } else {
+            _aligned_free(header);
+        }
+    }
+    
+    LONG getAllocations() const {
+        return allocations;
+    }
+    
+    // allocations served from a free list instead of the heap
+    LONG getReuses() const {
+        return reuses;
+    }
+};
+
+// global frame pool instance
+static FramePool globalFramePool;
+
+// future continuation that resumes an awaiting coroutine on the completing thread
+inline void ResumeCoroutineContinuation(void* address) {
+    std::coroutine_handle<>::from_address(address).resume();
+}
+
+// awaitable returned by scheduler.schedule(priority) - re-queues the coroutine as a task
+// the resume task is never lost: if it is refused at submit the coroutine carries on inline;
+// if it is dropped later (evicted, shed, cancelled at shutdown) the coroutine resumes on the
+// dropping thread - co_await returns the reason either way, FUTURE_READY when it hopped
+// the awaiter lives in the suspended frame, so the task can point at it
+template<typename Scheduler>
+class ScheduleAwaiter {
+private:
+    Scheduler* scheduler;
+    TaskPriority priority;
+    std::coroutine_handle<> handle;
+    FutureState outcome;
+    
+    // awaiter whose resume task this thread is submitting - a refusal inside that submit
+    // must not resume the coroutine from under await_suspend
+    static ScheduleAwaiter*& submitting() {
+        static thread_local ScheduleAwaiter* awaiter = nullptr;
+        return awaiter;
+    }
+    
+    static void ResumeTask(void* context) {
+        ((ScheduleAwaiter*)context)->handle.resume();
+    }
+    
+    static void DiscardResume(void* context, FutureState reason) {
+        ScheduleAwaiter* awaiter = (ScheduleAwaiter*)context;
+        awaiter->outcome = reason;
+        if (submitting() != awaiter) {
+            awaiter->handle.resume();
+        }
+    }
+    
+public:
+    ScheduleAwaiter(Scheduler* s, TaskPriority prio) : scheduler(s), priority(prio), outcome(FUTURE_READY) {}
+    
+    bool await_ready() const {
+        return false;
+    }
+    
+    // false = refused - continue on this thread without suspending
+    // once the task is queued a worker may resume (and finish) the coroutine at any moment,
+    // so nothing here touches 'this' after submitTask accepts it
+    bool await_suspend(std::coroutine_handle<> h) {
+        handle = h;
+        Task task(ResumeTask, this, priority);
+        task.onDiscard = DiscardResume;
+        
+        ScheduleAwaiter* outer = submitting();  // a caller-runs resume may nest another hop
+        submitting() = this;
+        bool queued = scheduler->submitTask(task);
+        submitting() = outer;
+        return queued;
+    }
+    
+    FutureState await_resume() const {
+        return outcome;
+    }
+};
+
+// awaiting a Future<T> - resumes on the thread that completes it (a worker for scheduler tasks)
+template<typename T>
+class FutureAwaiter {
+private:
+    Future<T>* future;
+    
+public:
+    FutureAwaiter(Future<T>* f) : future(f) {}
+    
+    bool await_ready() {
+        return future->ready();
+    }
+    
+    // false = already completed between await_ready and here - continue without suspending
+    bool await_suspend(std::coroutine_handle<> handle) {
+        return future->onReady(ResumeCoroutineContinuation, handle.address());
+    }
+    
+    // T() if the task was rejected/cancelled/expired - check getState()
+    T await_resume() {
+        return future->get();
+    }
+};
+
+template<typename T>
+FutureAwaiter<T> operator co_await(Future<T>& future) {
+    return FutureAwaiter<T>(&future);
+}
+
+// result storage shared by a running coroutine and its CoTask handle
+// void coroutines complete a Future<bool>
+template<typename T>
+struct CoTaskResult {
+    typedef T type;
+};
+
+template<>
+struct CoTaskResult<void> {
+    typedef bool type;
+};
+
+template<typename T>
+struct CoTaskState {
+    Future<typename CoTaskResult<T>::type> future;
+    volatile LONG refs;  // coroutine frame + CoTask handle
+    
+    CoTaskState() : refs(2) {}
+    
+    void release() {
+        if (InterlockedDecrement(&refs) == 0) {
+            delete this;
+        }
+    }
+};
+
+// promise pieces shared by CoTask<T> and CoTask<void>
+template<typename T>
+struct CoPromiseBase {
+    CoTaskState<T>* state;
+    
+    CoPromiseBase() : state(new CoTaskState<T>()) {}
+    
+    // starts running immediately on the caller's thread (until its first co_await)
+    std::suspend_never initial_suspend() {
+        return std::suspend_never();
+    }
+    
+    // frame is freed as soon as the body finishes
+    std::suspend_never final_suspend() noexcept {
+        return std::suspend_never();
+    }
+    
+    // no error channel in Future - an escaping exception is fatal
+    void unhandled_exception() {
+        std::terminate();
+    }
+    
+    static void* operator new(size_t size) {
+        return globalFramePool.allocate(size);
+    }
+    
+    static void operator delete(void* frame) {
+        globalFramePool.release(frame);
+    }
+};
+
+template<typename T>
+struct CoPromise : CoPromiseBase<T> {
+    void return_value(const T& value) {
+        this->state->future.setResult(value);
+        this->state->release();
+    }
+};
+
+template<>
+struct CoPromise<void> : CoPromiseBase<void> {
+    void return_void() {
+        state->future.setResult(true);
+        state->release();
+    }
+};
+
+// coroutine type - eager, resumes wherever it is woken (scheduler workers via schedule())
+template<typename T>
+class CoTask {
+public:
+    struct promise_type : CoPromise<T> {
+        CoTask get_return_object() {
+            return CoTask(this->state);
+        }
+    };
+    
+    typedef typename CoTaskResult<T>::type ResultType;
+    
+private:
+    CoTaskState<T>* state;
+    
+public:
+    explicit CoTask(CoTaskState<T>* s) : state(s) {}
+    
+    CoTask(CoTask&& other) noexcept : state(other.state) {
+        other.state = nullptr;
+    }
+    
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+    
+    ~CoTask() {
+        if (state != nullptr) {
+            state->release();
+        }
+    }
+    
+    // block until the coroutine returns
+    ResultType get() {
+        return state->future.get();
+    }
+    
+    bool ready() {
+        return state->future.ready();
+    }
+    
+    // co_await on another coroutine's result
+    FutureAwaiter<ResultType> operator co_await() {
+        return FutureAwaiter<ResultType>(&state->future);
+    }
+};
+
+#endif
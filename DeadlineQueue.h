@@ -0,0 +1,281 @@
+#ifndef DEADLINE_QUEUE_H
+#define DEADLINE_QUEUE_H
+
+#include <windows.h>
+#include "IdleStrategy.h"
+#include "TaskPriority.h"
+
+// absolute deadline in QueryPerformanceCounter ticks
+struct Deadline {
+    LONGLONG ticks;
+    
+    explicit Deadline(LONGLONG qpcTicks) : ticks(qpcTicks) {}
+    
+    // deadline 'ms' milliseconds from now
+    static Deadline fromNowMs(DWORD ms) {
+        LARGE_INTEGER now, freq;
+        QueryPerformanceCounter(&now);
+        QueryPerformanceFrequency(&freq);
+        return Deadline(now.QuadPart + (LONGLONG)ms * freq.QuadPart / 1000);
+    }
+};
+
+// earliest-deadline-first queue - d-ary min-heap keyed by absolute deadline
+// keys live in their own array, so comparing the Arity children of a node
+// touches one or two cache lines instead of striding over whole items
+// T needs 'priority', 'enqueueTime', 'deadline' (QPC ticks, 0 = derive from priority) and 'admitted'
+template<typename T, int Arity = 4>
+class DeadlineQueue {
+private:
+    struct HeapKey {
+        LONGLONG deadline;  // absolute deadline in QPC ticks
+        LONGLONG seq;       // FIFO order among equal deadlines
+    };
+    
+    HeapKey* keys;
+    T* items;  // items[i] belongs to keys[i]
+    int capacity;
+    volatile LONG count;  // read lock-free by spinning workers
+    LONGLONG nextSeq;
+    
+    // relative deadline per priority for tasks submitted without one
+    LONGLONG windowTicks[PRIORITY_LEVELS];
+    LARGE_INTEGER frequency;
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE notEmpty;
+    volatile bool isShutdown;
+    IdleState idle;
+    
+    static bool earlier(const HeapKey& a, const HeapKey& b) {
+        return a.deadline < b.deadline || (a.deadline == b.deadline && a.seq < b.seq);
+    }
+    
+    void grow() {
+        int newCapacity = capacity * 2;
+        HeapKey* biggerKeys = new HeapKey[newCapacity];
+        T* biggerItems = new T[newCapacity];
+        for (int i = 0; i < count; i++) {
+            biggerKeys[i] = keys[i];
+            biggerItems[i] = items[i];
+        }
+        delete[] keys;
+        delete[] items;
+        keys = biggerKeys;
+        items = biggerItems;
+        capacity = newCapacity;
+    }
+    
+    // move the hole at i up until 'key' fits, then drop key/item in
+    void siftUp(int i, const HeapKey& key, const T& item) {
+        while (i > 0) {
+            int parent = (i - 1) / Arity;
+            if (!earlier(key, keys[parent])) break;
+            keys[i] = keys[parent];
+            items[i] = items[parent];
+            i = parent;
+        }
+        keys[i] = key;
+        items[i] = item;
+    }
+    
+    // move the hole at i down until 'key' fits
+    void siftDown(int i, const HeapKey& key, const T& item) {
+        int n = count;
+        while (true) {
+            int first = Arity * i + 1;
+            if (first >= n) break;
+            
+            int last = first + Arity;
+            if (last > n) last = n;
+            
+            int best = first;
+            for (int c = first + 1; c < last; c++) {
+                if (earlier(keys[c], keys[best])) {
+                    best = c;
+                }
+            }
+            
+            if (!earlier(keys[best], key)) break;
+            keys[i] = keys[best];
+            items[i] = items[best];
+            i = best;
+        }
+        keys[i] = key;
+        items[i] = item;
+    }
+    
+    // pop the earliest deadline (under cs, count > 0)
+    void takeNext(T& outValue) {
+        outValue = items[0];
+        count--;
+        if (count > 0) {
+            siftDown(0, keys[count], items[count]);
+        }
+    }
+    
+public:
+    DeadlineQueue() : capacity(64), count(0), nextSeq(0), isShutdown(false) {
+        keys = new HeapKey[capacity];
+        items = new T[capacity];
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&notEmpty);
+        QueryPerformanceFrequency(&frequency);
+        
+        // default windows: CRITICAL 10ms, HIGH 50ms, MEDIUM 200ms, LOW 1s
+        DWORD defaults[PRIORITY_LEVELS] = { 1000, 200, 50, 10 };
+        setPriorityWindows(defaults);
+    }
+    
+    ~DeadlineQueue() {
+        EnterCriticalSection(&cs);
+        delete[] keys;
+        delete[] items;
+        LeaveCriticalSection(&cs);
+        DeleteCriticalSection(&cs);
+    }
+    
+    // enqueue - O(log_Arity n) sift-up by deadline
+    void enqueue(const T& value) {
+        EnterCriticalSection(&cs);
+        
+        if (count == capacity) {
+            grow();
+        }
+        
+        HeapKey key;
+        key.seq = nextSeq++;
+        if (value.deadline != 0) {
+            key.deadline = value.deadline;
+        } else {
+            int level = (value.priority < 0 || value.priority >= PRIORITY_LEVELS) ? MEDIUM : value.priority;
+            key.deadline = value.enqueueTime + windowTicks[level];
+        }
+        
+        count++;
+        siftUp(count - 1, key, value);
+        
+        LeaveCriticalSection(&cs);
+        
+        // wake outside the lock, and only if no worker is already spinning for work
+        if (idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+    }
+    
+    // dequeue - remove the item with the earliest deadline
+    bool dequeue(T& outValue) {
+        if (count == 0 && !isShutdown) {
+            idle.spinForWork(&count, &isShutdown);
+        }
+        
+        EnterCriticalSection(&cs);
+        
+        while (count == 0 && !isShutdown) {
+            idle.parking();
+            SleepConditionVariableCS(&notEmpty, &cs, INFINITE);
+            idle.unparked();
+        }
+        
+        if (isShutdown && count == 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        takeNext(outValue);
+        LONG remaining = count;
+        
+        LeaveCriticalSection(&cs);
+        
+        if (remaining > 0 && idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+    
+    // non-blocking dequeue - false if nothing is queued (waiters helping out use this)
+    bool tryDequeue(T& outValue) {
+        if (count == 0) return false;
+        
+        EnterCriticalSection(&cs);
+        
+        if (count == 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        takeNext(outValue);
+        
+        LeaveCriticalSection(&cs);
+        return true;
+    }
+    
+    void shutdown() {
+        EnterCriticalSection(&cs);
+        isShutdown = true;
+        WakeAllConditionVariable(&notEmpty);
+        LeaveCriticalSection(&cs);
+    }
+    
+    // remove the oldest queued item of one priority level (overflow drop policy) - O(n) scan
+    // admitted items are never evicted
+    bool evictOldest(int priority, T& outValue) {
+        EnterCriticalSection(&cs);
+        
+        int victim = -1;
+        for (int i = 0; i < count; i++) {
+            if (items[i].priority == priority && !items[i].admitted &&
+                (victim < 0 || keys[i].seq < keys[victim].seq)) {
+                victim = i;
+            }
+        }
+        
+        if (victim < 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        outValue = items[victim];
+        count--;
+        if (victim < count) {
+            // refill the hole with the last entry, then restore heap order in either direction
+            HeapKey key = keys[count];
+            T item = items[count];
+            if (victim > 0 && earlier(key, keys[(victim - 1) / Arity])) {
+                siftUp(victim, key, item);
+            } else {
+                siftDown(victim, key, item);
+            }
+        }
+        
+        LeaveCriticalSection(&cs);
+        return true;
+    }
+    
+    // policy hook - called when a dequeued task is done (nothing to track here)
+    void taskFinished(const T&) {}
+    
+    void setIdleStrategy(const IdleStrategy& strategy) {
+        idle.setStrategy(strategy);
+    }
+    
+    LONG getSpinningWorkers() const {
+        return idle.getSpinningWorkers();
+    }
+    
+    // relative deadline (ms) per priority, used when a task has no explicit deadline
+    void setPriorityWindows(const DWORD windowMs[PRIORITY_LEVELS]) {
+        EnterCriticalSection(&cs);
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            windowTicks[i] = (LONGLONG)windowMs[i] * frequency.QuadPart / 1000;
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    // lock-free snapshot - count is an aligned volatile LONG, so the read is atomic
+    int size() const {
+        return count;
+    }
+};
+
+#endif
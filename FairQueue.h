@@ -0,0 +1,247 @@
+#ifndef FAIR_QUEUE_H
+#define FAIR_QUEUE_H
+
+#include <windows.h>
+#include "IdleStrategy.h"
+#include "TaskPriority.h"
+
+// weighted fair queue - each priority level gets a share of dispatches
+// proportional to its weight (stride scheduling), so LOW is slowed down but never starved
+// T needs 'priority' (0..Levels-1) and 'admitted'
+template<typename T, int Levels = PRIORITY_LEVELS>
+class FairQueue {
+private:
+    struct Node {
+        T data;
+        Node* next;
+        
+        Node(const T& value) : data(value), next(nullptr) {}
+    };
+    
+    struct Bucket {
+        Node* head;
+        Node* tail;
+        LONGLONG pass;    // virtual time of this level's next dispatch
+        LONGLONG stride;  // STRIDE_ONE / weight
+        
+        Bucket() : head(nullptr), tail(nullptr), pass(0), stride(0) {}
+    };
+    
+    static const LONGLONG STRIDE_ONE = 1 << 20;
+    
+    Bucket buckets[Levels];
+    LONGLONG virtualTime;  // pass of the last dispatched level
+    volatile LONG count;   // read lock-free by spinning workers
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE notEmpty;
+    volatile bool isShutdown;
+    IdleState idle;
+    
+    static int clampLevel(int priority) {
+        if (priority < 0) return 0;
+        if (priority >= Levels) return Levels - 1;
+        return priority;
+    }
+    
+    // non-empty level with the smallest pass, higher level wins ties
+    int pickLevel() {
+        int best = -1;
+        for (int level = Levels - 1; level >= 0; level--) {
+            if (buckets[level].head == nullptr) continue;
+            if (best < 0 || buckets[level].pass < buckets[best].pass) {
+                best = level;
+            }
+        }
+        return best;
+    }
+    
+    // unlink the next item to run and advance its level's pass (under cs, count > 0)
+    Node* takeNext() {
+        Bucket& bucket = buckets[pickLevel()];
+        virtualTime = bucket.pass;
+        bucket.pass += bucket.stride;
+        
+        Node* temp = bucket.head;
+        bucket.head = temp->next;
+        if (bucket.head == nullptr) {
+            bucket.tail = nullptr;
+        }
+        count--;
+        return temp;
+    }
+    
+public:
+    FairQueue() : virtualTime(0), count(0), isShutdown(false) {
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&notEmpty);
+        
+        // default weights: LOW 1, MEDIUM 2, HIGH 4, CRITICAL 8
+        for (int i = 0; i < Levels; i++) {
+            buckets[i].stride = STRIDE_ONE / ((LONGLONG)1 << i);
+        }
+    }
+    
+    ~FairQueue() {
+        EnterCriticalSection(&cs);
+        
+        for (int i = 0; i < Levels; i++) {
+            while (buckets[i].head != nullptr) {
+                Node* temp = buckets[i].head;
+                buckets[i].head = buckets[i].head->next;
+                delete temp;
+            }
+        }
+        
+        LeaveCriticalSection(&cs);
+        DeleteCriticalSection(&cs);
+    }
+    
+    void enqueue(const T& value) {
+        Node* newNode = new Node(value);
+        int level = clampLevel(value.priority);
+        
+        EnterCriticalSection(&cs);
+        
+        Bucket& bucket = buckets[level];
+        if (bucket.tail == nullptr) {
+            // a level returning from idle must not cash in credit it didn't use
+            if (bucket.pass < virtualTime) {
+                bucket.pass = virtualTime;
+            }
+            bucket.head = bucket.tail = newNode;
+        } else {
+            bucket.tail->next = newNode;
+            bucket.tail = newNode;
+        }
+        
+        count++;
+        
+        LeaveCriticalSection(&cs);
+        
+        if (idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+    }
+    
+    bool dequeue(T& outValue) {
+        if (count == 0 && !isShutdown) {
+            idle.spinForWork(&count, &isShutdown);
+        }
+        
+        EnterCriticalSection(&cs);
+        
+        while (count == 0 && !isShutdown) {
+            idle.parking();
+            SleepConditionVariableCS(&notEmpty, &cs, INFINITE);
+            idle.unparked();
+        }
+        
+        if (isShutdown && count == 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        Node* temp = takeNext();
+        outValue = temp->data;
+        LONG remaining = count;
+        
+        LeaveCriticalSection(&cs);
+        
+        delete temp;
+        
+        if (remaining > 0 && idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+    
+    // non-blocking dequeue - false if nothing is queued (waiters helping out use this)
+    bool tryDequeue(T& outValue) {
+        if (count == 0) return false;
+        
+        EnterCriticalSection(&cs);
+        
+        if (count == 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        Node* temp = takeNext();
+        outValue = temp->data;
+        
+        LeaveCriticalSection(&cs);
+        
+        delete temp;
+        return true;
+    }
+    
+    void shutdown() {
+        EnterCriticalSection(&cs);
+        isShutdown = true;
+        WakeAllConditionVariable(&notEmpty);
+        LeaveCriticalSection(&cs);
+    }
+    
+    // remove the oldest queued item of one priority level (overflow drop policy)
+    // admitted items are never evicted - they are stepped over
+    bool evictOldest(int priority, T& outValue) {
+        EnterCriticalSection(&cs);
+        
+        Bucket& bucket = buckets[clampLevel(priority)];
+        Node* prev = nullptr;
+        Node* temp = bucket.head;
+        while (temp != nullptr && temp->data.admitted) {
+            prev = temp;
+            temp = temp->next;
+        }
+        if (temp == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        outValue = temp->data;
+        if (prev == nullptr) {
+            bucket.head = temp->next;
+        } else {
+            prev->next = temp->next;
+        }
+        if (bucket.tail == temp) {
+            bucket.tail = prev;
+        }
+        count--;
+        
+        LeaveCriticalSection(&cs);
+        
+        delete temp;
+        return true;
+    }
+    
+    // policy hook - called when a dequeued task is done (nothing to track here)
+    void taskFinished(const T&) {}
+    
+    void setIdleStrategy(const IdleStrategy& strategy) {
+        idle.setStrategy(strategy);
+    }
+    
+    LONG getSpinningWorkers() const {
+        return idle.getSpinningWorkers();
+    }
+    
+    // relative share per level (weight 0 is treated as 1)
+    void setWeights(const DWORD weights[Levels]) {
+        EnterCriticalSection(&cs);
+        for (int i = 0; i < Levels; i++) {
+            DWORD w = weights[i] == 0 ? 1 : weights[i];
+            buckets[i].stride = STRIDE_ONE / w;
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    // lock-free snapshot - count is an aligned volatile LONG, so the read is atomic
+    int size() const {
+        return count;
+    }
+};
+
+#endif
@@ -3,17 +3,82 @@
 
 #include <windows.h>
 
+// how a future was completed
+enum FutureState {
+    FUTURE_PENDING,
+    FUTURE_READY,      // result is available
+    FUTURE_REJECTED,   // task was refused or dropped by a full queue
+    FUTURE_CANCELLED,  // task was cancelled before it ran
+    FUTURE_EXPIRED     // task waited in the queue past its max wait and was shed
+};
+
+// callback run once when a future completes (coroutine resumption, chaining)
+typedef void (*ContinuationFunction)(void*);
+
+// lets a blocking get()/wait() on a scheduler worker run other queued tasks instead
+// of sleeping (a small pool would otherwise idle or deadlock on nested fork-join)
+// help(context) runs at most one task and returns false if there was none
+typedef bool (*HelpFunction)(void* context);
+
+struct WaitHelper {
+    HelpFunction help;
+    void* context;
+    int priority;  // priority of the task running on this worker (-1 = none)
+};
+
+// raises the priority of the queued task that will complete a future (priority inheritance)
+typedef void (*BoostFunction)(void* context, int priority);
+
+// helper for the calling thread - set by scheduler workers, nullptr elsewhere
+inline WaitHelper*& currentWaitHelper() {
+    static thread_local WaitHelper* helper = nullptr;
+    return helper;
+}
+
 // future - holds result of async task
 template<typename T>
 class Future {
 private:
+    struct Continuation {
+        ContinuationFunction function;
+        void* context;
+        Continuation* next;
+        
+        Continuation(ContinuationFunction func, void* ctx) : function(func), context(ctx), next(nullptr) {}
+    };
+    
     T* result;
-    bool isReady;
+    bool isReady;  // completed - with a result or a failure state
+    FutureState state;
+    Continuation* continuations;  // run by whoever completes the future
+    BoostFunction boostFunction;  // set while the producing task is queued
+    void* boostContext;
     CRITICAL_SECTION cs;
     CONDITION_VARIABLE cv;
     
+    static const DWORD HELP_POLL_MS = 1;  // nap between queue checks while helping with nothing to run
+    
+    // under cs - the hook re-queues the producer, so it stays valid while we hold the lock
+    void boostLocked(int priority) {
+        if (!isReady && boostFunction != nullptr && priority >= 0) {
+            boostFunction(boostContext, priority);
+        }
+    }
+    
+    // run detached continuations - called after leaving cs, must not touch 'this'
+    // (a continuation may resume a coroutine that deletes the future)
+    static void runContinuations(Continuation* list) {
+        while (list != nullptr) {
+            Continuation* next = list->next;
+            list->function(list->context);
+            delete list;
+            list = next;
+        }
+    }
+    
 public:
-    Future() : result(nullptr), isReady(false) {
+    Future() : result(nullptr), isReady(false), state(FUTURE_PENDING), continuations(nullptr),
+               boostFunction(nullptr), boostContext(nullptr) {
         InitializeCriticalSection(&cs);
         InitializeConditionVariable(&cv);
     }
@@ -22,6 +87,11 @@ public:
         if (result != nullptr) {
             delete result;
         }
+        while (continuations != nullptr) {
+            Continuation* next = continuations->next;
+            delete continuations;
+            continuations = next;
+        }
         DeleteCriticalSection(&cs);
     }
     
@@ -35,15 +105,126 @@ public:
         
         result = new T(value);
         isReady = true;
+        state = FUTURE_READY;
         
         // wake all waiting threads
         WakeAllConditionVariable(&cv);
         
+        Continuation* pending = continuations;
+        continuations = nullptr;
+        boostFunction = nullptr;
+        
+        LeaveCriticalSection(&cs);
+        
+        runContinuations(pending);
+    }
+    
+    // complete without a result (task never ran) - get() then returns T()
+    void fail(FutureState failState) {
+        EnterCriticalSection(&cs);
+        
+        Continuation* pending = nullptr;
+        if (!isReady) {
+            isReady = true;
+            state = failState;
+            WakeAllConditionVariable(&cv);
+            
+            pending = continuations;
+            continuations = nullptr;
+            boostFunction = nullptr;
+        }
+        
+        LeaveCriticalSection(&cs);
+        
+        runContinuations(pending);
+    }
+    
+    // run 'function(context)' once the future completes, on the completing thread
+    // returns false (and registers nothing) if it is already complete
+    bool onReady(ContinuationFunction function, void* context) {
+        EnterCriticalSection(&cs);
+        
+        if (isReady) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        // a coroutine on a worker attaching counts as waiting
+        WaitHelper* helper = currentWaitHelper();
+        if (helper != nullptr) {
+            boostLocked(helper->priority);
+        }
+        
+        Continuation* c = new Continuation(function, context);
+        c->next = continuations;
+        continuations = c;
+        
         LeaveCriticalSection(&cs);
+        return true;
+    }
+    
+    // hook the scheduler installs for a still-queued producer; cleared on completion
+    void setBoost(BoostFunction function, void* context) {
+        EnterCriticalSection(&cs);
+        if (!isReady) {
+            boostFunction = function;
+            boostContext = context;
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    // a waiter of 'priority' needs this future - lift the producer to at least that level
+    void boost(int priority) {
+        EnterCriticalSection(&cs);
+        boostLocked(priority);
+        LeaveCriticalSection(&cs);
+    }
+    
+    // worker side of get()/wait(): run queued tasks until this future completes
+    // false if timeoutMs ran out first
+    bool helpWhileWaiting(WaitHelper* helper, DWORD timeoutMs) {
+        ULONGLONG start = GetTickCount64();
+        
+        while (true) {
+            EnterCriticalSection(&cs);
+            
+            if (isReady) {
+                LeaveCriticalSection(&cs);
+                return true;
+            }
+            
+            DWORD remaining = INFINITE;
+            if (timeoutMs != INFINITE) {
+                ULONGLONG elapsed = GetTickCount64() - start;
+                if (elapsed >= timeoutMs) {
+                    LeaveCriticalSection(&cs);
+                    return false;
+                }
+                remaining = (DWORD)(timeoutMs - elapsed);
+            }
+            
+            LeaveCriticalSection(&cs);
+            
+            if (!helper->help(helper->context)) {
+                // queue empty - the producer is running elsewhere; wake on completion or recheck soon
+                EnterCriticalSection(&cs);
+                if (!isReady) {
+                    SleepConditionVariableCS(&cv, &cs, remaining < HELP_POLL_MS ? remaining : HELP_POLL_MS);
+                }
+                LeaveCriticalSection(&cs);
+            }
+        }
     }
     
-    // get result (blocking - waits until ready)
+    // get result (blocking - waits until ready; on a worker, runs other tasks meanwhile)
+    // returns T() if the task was rejected/cancelled/expired - check getState()
     T get() {
+        WaitHelper* helper = currentWaitHelper();
+        if (helper != nullptr) {
+            boost(helper->priority);
+            helpWhileWaiting(helper, INFINITE);
+        }
+        
         EnterCriticalSection(&cs);
         
         // wait until result is ready
@@ -51,7 +232,7 @@ public:
             SleepConditionVariableCS(&cv, &cs, INFINITE);
         }
         
-        T value = *result;
+        T value = (result != nullptr) ? *result : T();
         
         LeaveCriticalSection(&cs);
         
@@ -66,8 +247,21 @@ public:
         return r;
     }
     
-    // wait with timeout (milliseconds)
+    FutureState getState() {
+        EnterCriticalSection(&cs);
+        FutureState st = state;
+        LeaveCriticalSection(&cs);
+        return st;
+    }
+    
+    // wait with timeout (milliseconds) - on a worker, runs other tasks meanwhile
     bool wait(DWORD timeoutMs) {
+        WaitHelper* helper = currentWaitHelper();
+        if (helper != nullptr) {
+            boost(helper->priority);
+            return helpWhileWaiting(helper, timeoutMs);
+        }
+        
         EnterCriticalSection(&cs);
         
         if (isReady) {
@@ -112,4 +306,12 @@ void ReturnTaskWrapper(void* arg) {
     delete task;
 }
 
+// discard hook for return tasks - completes the future with a failure state
+template<typename T>
+void ReturnTaskDiscard(void* arg, FutureState reason) {
+    TaskWithReturn<T>* task = (TaskWithReturn<T>*)arg;
+    task->future->fail(reason);
+    delete task;
+}
+
 #endif
\ No newline at end of file
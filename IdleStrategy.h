@@ -0,0 +1,99 @@
+#ifndef IDLE_STRATEGY_H
+#define IDLE_STRATEGY_H
+
+#include <windows.h>
+#include "WorkerState.h"
+
+// idle strategy for workers - spin with pause, then yield, then park
+struct IdleStrategy {
+    int spinCount;   // busy-wait rounds (YieldProcessor = pause instruction)
+    int yieldCount;  // SwitchToThread rounds before parking on the condition variable
+    
+    IdleStrategy(int spins = 1000, int yields = 10) : spinCount(spins), yieldCount(yields) {}
+    
+    // old behaviour - go straight to sleep when the queue is empty
+    static IdleStrategy parkOnly() {
+        return IdleStrategy(0, 0);
+    }
+};
+
+// per-queue idle bookkeeping - how many workers are spinning / parked
+// producers use it to skip the wake syscall when someone is already looking for work
+class IdleState {
+private:
+    IdleStrategy strategy;
+    volatile LONG spinningWorkers;
+    volatile LONG parkedWorkers;
+    
+public:
+    IdleState() : spinningWorkers(0), parkedWorkers(0) {}
+    
+    void setStrategy(const IdleStrategy& s) {
+        strategy = s;
+    }
+    
+    const IdleStrategy& getStrategy() const {
+        return strategy;
+    }
+    
+    // spin, then yield, until 'available' becomes non-zero or shutdown is flagged
+    // reads are lock-free - the caller re-checks under its lock afterwards
+    bool spinForWork(volatile LONG* available, volatile bool* shutdown) {
+        if (strategy.spinCount <= 0 && strategy.yieldCount <= 0) {
+            return false;
+        }
+        
+        InterlockedIncrement(&spinningWorkers);
+        WorkerClock* clock = currentWorkerClock();
+        WorkerState previous = (clock != nullptr) ? clock->enter(WORKER_SPINNING) : WORKER_QUEUE;
+        
+        bool found = false;
+        for (int i = 0; i < strategy.spinCount && !found; i++) {
+            YieldProcessor();
+            found = (*available > 0) || *shutdown;
+        }
+        
+        for (int i = 0; i < strategy.yieldCount && !found; i++) {
+            SwitchToThread();
+            found = (*available > 0) || *shutdown;
+        }
+        
+        if (clock != nullptr) {
+            clock->enter(previous);
+        }
+        InterlockedDecrement(&spinningWorkers);
+        return found;
+    }
+    
+    // called under the queue lock around SleepConditionVariableCS
+    void parking() {
+        InterlockedIncrement(&parkedWorkers);
+        WorkerClock* clock = currentWorkerClock();
+        if (clock != nullptr) {
+            clock->enter(WORKER_PARKED);
+        }
+    }
+    
+    void unparked() {
+        WorkerClock* clock = currentWorkerClock();
+        if (clock != nullptr) {
+            clock->enter(WORKER_QUEUE);  // parking only happens inside dequeue
+        }
+        InterlockedDecrement(&parkedWorkers);
+    }
+    
+    // producer side (outside the lock) - only wake when nobody is spinning
+    bool shouldWake() const {
+        return spinningWorkers == 0 && parkedWorkers > 0;
+    }
+    
+    LONG getSpinningWorkers() const {
+        return spinningWorkers;
+    }
+    
+    LONG getParkedWorkers() const {
+        return parkedWorkers;
+    }
+};
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef IO_REACTOR_H
+#define IO_REACTOR_H
+
+// winsock2.h must come before windows.h - include this header first (it brings in TaskScheduler.h)
+#include <winsock2.h>
+#include <mswsock.h>
+#include <windows.h>
+#include "TaskScheduler.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+// outcome of an async I/O operation
+struct IoResult {
+    DWORD bytes;  // bytes transferred
+    DWORD error;  // Win32 error code, 0 = success (ERROR_HANDLE_EOF at end of file)
+    
+    IoResult() : bytes(0), error(0) {}
+    IoResult(DWORD n, DWORD err) : bytes(n), error(err) {}
+    
+    bool ok() const {
+        return error == 0;
+    }
+};
+
+// one in-flight operation - owned by the reactor until its completion task runs
+struct IoOperation {
+    OVERLAPPED overlapped;  // must stay first - the completion port hands back this pointer
+    HANDLE handle;          // nullptr for timers
+    Future<IoResult>* future;
+    IoResult result;
+    TaskPriority priority;
+    SOCKET listenSocket;    // accept only
+    SOCKET acceptSocket;    // accept only
+    char* acceptBuffer;     // accept only - local/remote addresses written by AcceptEx
+    IoOperation* next;      // batch of due timers
+    
+    IoOperation(HANDLE h, ULONGLONG offset, TaskPriority prio)
+        : handle(h), future(new Future<IoResult>()), priority(prio),
+          listenSocket(INVALID_SOCKET), acceptSocket(INVALID_SOCKET), acceptBuffer(nullptr), next(nullptr) {
+        ZeroMemory(&overlapped, sizeof(overlapped));
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    }
+    
+    ~IoOperation() {
+        delete[] acceptBuffer;
+    }
+};
+
+// completion task - runs on a scheduler worker, so continuations (awaiting coroutines) do too
+inline void CompleteIoTask(void* argument) {
+    IoOperation* op = (IoOperation*)argument;
+    Future<IoResult>* future = op->future;
+    IoResult result = op->result;
+    delete op;
+    
+    future->setResult(result);
+}
+
+// completion task dropped without running - the future carries the reason
+// (completions are admitted tasks, which the scheduler never evicts or sheds; this only keeps a
+// drop from leaking the operation and leaving the future pending)
+inline void DiscardIoTask(void* argument, FutureState reason) {
+    IoOperation* op = (IoOperation*)argument;
+    Future<IoResult>* future = op->future;
+    delete op;
+    
+    future->fail(reason);
+}
+
+// I/O reactor on a completion port - one thread waits for completions (and timers)
+// and hands each one to the scheduler as a normal task, so workers never block in I/O
+// completions are admitted past the queue's capacity and overflow policy: the port thread
+// never waits for space and never runs a continuation itself, and a queued completion is
+// never evicted or shed - its result is already in the caller's buffer
+// handles must be opened for overlapped I/O (FILE_FLAG_OVERLAPPED, WSASocket with
+// WSA_FLAG_OVERLAPPED, named pipes - anonymous pipes do not support it) and associated first
+// every returned Future<IoResult> is owned by the caller
+template<typename Scheduler>
+class IoReactor {
+private:
+    static const ULONG_PTR IO_KEY = 1;
+    static const ULONG_PTR WAKE_KEY = 2;  // timer list changed - recompute the wait
+    static const ULONG_PTR STOP_KEY = 3;
+    static const ULONG BATCH = 64;        // completions dequeued per wait
+    static const DWORD ACCEPT_ADDRESS_SIZE = sizeof(SOCKADDR_STORAGE) + 16;
+    
+    struct TimerEntry {
+        ULONGLONG due;  // GetTickCount64 time
+        IoOperation* op;
+    };
+    
+    Scheduler* scheduler;
+    HANDLE port;
+    HANDLE reactorThread;
+    LPFN_ACCEPTEX acceptEx;  // loaded on first accept
+    
+    // binary min-heap of timers by due time
+    TimerEntry* timers;
+    int timerCount;
+    int timerCapacity;
+    CRITICAL_SECTION timerCs;
+    
+    static DWORD WINAPI ReactorThreadFunction(LPVOID param) {
+        IoReactor* reactor = (IoReactor*)param;
+        OVERLAPPED_ENTRY entries[BATCH];
+        
+        while (true) {
+            DWORD timeout = reactor->fireTimers();
+            
+            ULONG removed = 0;
+            if (!GetQueuedCompletionStatusEx(reactor->port, entries, BATCH, &removed, timeout, FALSE)) {
+                if (GetLastError() == WAIT_TIMEOUT) continue;
+                globalLogger.error("IoReactor: completion port wait failed");
+                break;
+            }
+            
+            bool stop = false;
+            for (ULONG i = 0; i < removed; i++) {
+                if (entries[i].lpCompletionKey == STOP_KEY) {
+                    stop = true;
+                } else if (entries[i].lpOverlapped != nullptr) {
+                    reactor->completed((IoOperation*)entries[i].lpOverlapped);
+                }
+            }
+            
+            if (stop) break;
+        }
+        return 0;
+    }
+    
+    // an operation finished on the port (reactor thread)
+    void completed(IoOperation* op) {
+        DWORD bytes = 0;
+        if (GetOverlappedResult(op->handle, &op->overlapped, &bytes, FALSE)) {
+            op->result = IoResult(bytes, 0);
+            
+            // the accepted socket inherits the listener's properties only after this
+            if (op->acceptSocket != INVALID_SOCKET) {
+                setsockopt(op->acceptSocket, SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
+                           (char*)&op->listenSocket, sizeof(op->listenSocket));
+            }
+        } else {
+            op->result = IoResult(bytes, GetLastError());
+        }
+        dispatch(op);
+    }
+    
+    // hand the completion to a worker - the operation was admitted when it was issued
+    void dispatch(IoOperation* op) {
+        Task task(CompleteIoTask, op, op->priority);
+        task.onDiscard = DiscardIoTask;
+        scheduler->submitAdmittedTask(task);
+    }
+    
+    // after issuing an operation: anything but IO_PENDING means no completion packet will come
+    // (success still queues a packet - the handles are not in skip-on-success mode)
+    void issued(IoOperation* op, BOOL ok, DWORD error) {
+        if (ok || error == ERROR_IO_PENDING) return;
+        
+        op->result = IoResult(0, error);
+        dispatch(op);
+    }
+    
+    void siftTimerUp(int i) {
+        TimerEntry entry = timers[i];
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (timers[parent].due <= entry.due) break;
+            timers[i] = timers[parent];
+            i = parent;
+        }
+        timers[i] = entry;
+    }
+    
+    void siftTimerDown(int i) {
+        TimerEntry entry = timers[i];
+        while (true) {
+            int child = 2 * i + 1;
+            if (child >= timerCount) break;
+            if (child + 1 < timerCount && timers[child + 1].due < timers[child].due) {
+                child++;
+            }
+            if (entry.due <= timers[child].due) break;
+            timers[i] = timers[child];
+            i = child;
+        }
+        timers[i] = entry;
+    }
+    
+    // dispatch due timers, return ms until the next one (INFINITE if none)
+    DWORD fireTimers() {
+        IoOperation* due = nullptr;
+        DWORD timeout = INFINITE;
+        
+        EnterCriticalSection(&timerCs);
+        
+        ULONGLONG now = GetTickCount64();
+        while (timerCount > 0 && timers[0].due <= now) {
+            IoOperation* op = timers[0].op;
+            op->next = due;
+            due = op;
+            
+            timerCount--;
+            if (timerCount > 0) {
+                timers[0] = timers[timerCount];
+                siftTimerDown(0);
+            }
+        }
+        if (timerCount > 0) {
+            timeout = (DWORD)(timers[0].due - now);
+        }
+        
+        LeaveCriticalSection(&timerCs);
+        
+        while (due != nullptr) {
+            IoOperation* next = due->next;
+            dispatch(due);
+            due = next;
+        }
+        return timeout;
+    }
+    
+public:
+    IoReactor(Scheduler* s) : scheduler(s), acceptEx(nullptr),
+                              timerCount(0), timerCapacity(16) {
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+        
+        timers = new TimerEntry[timerCapacity];
+        InitializeCriticalSection(&timerCs);
+        
+        port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+        reactorThread = CreateThread(nullptr, 0, ReactorThreadFunction, this, 0, nullptr);
+        
+        globalLogger.info("IoReactor started");
+    }
+    
+    // close (or CancelIoEx) the associated handles and let their completions drain first -
+    // operations still in flight here are never completed
+    ~IoReactor() {
+        PostQueuedCompletionStatus(port, 0, STOP_KEY, nullptr);
+        WaitForSingleObject(reactorThread, INFINITE);
+        CloseHandle(reactorThread);
+        CloseHandle(port);
+        
+        // timers that never fired
+        for (int i = 0; i < timerCount; i++) {
+            Future<IoResult>* future = timers[i].op->future;
+            delete timers[i].op;
+            future->fail(FUTURE_CANCELLED);
+        }
+        delete[] timers;
+        DeleteCriticalSection(&timerCs);
+        
+        WSACleanup();
+    }
+    
+    // attach an overlapped handle/socket to the reactor - once per handle, before any I/O on it
+    bool associate(HANDLE handle) {
+        return CreateIoCompletionPort(handle, port, IO_KEY, 0) != nullptr;
+    }
+    
+    bool associate(SOCKET socket) {
+        return associate((HANDLE)socket);
+    }
+    
+    // async read (file, named pipe or socket) - offset is ignored for pipes and sockets
+    Future<IoResult>* read(HANDLE handle, void* buffer, DWORD bytes, ULONGLONG offset = 0, TaskPriority priority = MEDIUM) {
+        IoOperation* op = new IoOperation(handle, offset, priority);
+        Future<IoResult>* future = op->future;  // op may be gone as soon as the call returns
+        
+        BOOL ok = ReadFile(handle, buffer, bytes, nullptr, &op->overlapped);
+        issued(op, ok, ok ? 0 : GetLastError());
+        return future;
+    }
+    
+    Future<IoResult>* read(SOCKET socket, void* buffer, DWORD bytes, TaskPriority priority = MEDIUM) {
+        return read((HANDLE)socket, buffer, bytes, 0, priority);
+    }
+    
+    // async write (file, named pipe or socket)
+    Future<IoResult>* write(HANDLE handle, const void* buffer, DWORD bytes, ULONGLONG offset = 0, TaskPriority priority = MEDIUM) {
+        IoOperation* op = new IoOperation(handle, offset, priority);
+        Future<IoResult>* future = op->future;
+        
+        BOOL ok = WriteFile(handle, buffer, bytes, nullptr, &op->overlapped);
+        issued(op, ok, ok ? 0 : GetLastError());
+        return future;
+    }
+    
+    Future<IoResult>* write(SOCKET socket, const void* buffer, DWORD bytes, TaskPriority priority = MEDIUM) {
+        return write((HANDLE)socket, buffer, bytes, 0, priority);
+    }
+    
+    // async accept - acceptSocket is a fresh unbound, unconnected socket of the listener's family
+    // it is connected when the future completes (associate it before reading from it)
+    Future<IoResult>* accept(SOCKET listenSocket, SOCKET acceptSocket, TaskPriority priority = MEDIUM) {
+        IoOperation* op = new IoOperation((HANDLE)listenSocket, 0, priority);
+        Future<IoResult>* future = op->future;
+        
+        if (acceptEx == nullptr) {
+            GUID guid = WSAID_ACCEPTEX;
+            DWORD returned = 0;
+            if (WSAIoctl(listenSocket, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+                         &acceptEx, sizeof(acceptEx), &returned, nullptr, nullptr) == SOCKET_ERROR) {
+                issued(op, FALSE, WSAGetLastError());
+                return future;
+            }
+        }
+        
+        op->listenSocket = listenSocket;
+        op->acceptSocket = acceptSocket;
+        op->acceptBuffer = new char[2 * ACCEPT_ADDRESS_SIZE];
+        
+        DWORD received = 0;
+        BOOL ok = acceptEx(listenSocket, acceptSocket, op->acceptBuffer, 0,
+                           ACCEPT_ADDRESS_SIZE, ACCEPT_ADDRESS_SIZE, &received, &op->overlapped);
+        issued(op, ok, ok ? 0 : WSAGetLastError());
+        return future;
+    }
+    
+    // completes (with an empty result) after 'ms' milliseconds
+    Future<IoResult>* after(DWORD ms, TaskPriority priority = MEDIUM) {
+        IoOperation* op = new IoOperation(nullptr, 0, priority);
+        Future<IoResult>* future = op->future;
+        
+        EnterCriticalSection(&timerCs);
+        
+        if (timerCount == timerCapacity) {
+            TimerEntry* bigger = new TimerEntry[timerCapacity * 2];
+            for (int i = 0; i < timerCount; i++) {
+                bigger[i] = timers[i];
+            }
+            delete[] timers;
+            timers = bigger;
+            timerCapacity *= 2;
+        }
+        
+        timers[timerCount].due = GetTickCount64() + ms;
+        timers[timerCount].op = op;
+        timerCount++;
+        siftTimerUp(timerCount - 1);
+        bool earliest = (timers[0].op == op);
+        
+        LeaveCriticalSection(&timerCs);
+        
+        // the reactor may be sleeping until a later timer
+        if (earliest) {
+            PostQueuedCompletionStatus(port, 0, WAKE_KEY, nullptr);
+        }
+        return future;
+    }
+};
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef MEMO_CACHE_H
+#define MEMO_CACHE_H
+
+#include <windows.h>
+#include "TaskScheduler.h"
+
+// memoizing front end for enqueueTaskWithReturn - for pure functions only
+// results are cached by (function, caller-provided argument hash) in a sharded, size-bounded LRU:
+//   hit       - the returned future is already complete, nothing is queued
+//   in flight - the caller joins the running computation instead of starting another
+//   miss      - one task is queued; every caller for that key shares its result
+// each caller owns (and deletes) the future it gets back, as with enqueueTaskWithReturn
+// failures (rejected, expired) are handed to the waiting callers and not cached
+template<typename Scheduler, typename T>
+class MemoCache {
+private:
+    typedef T (*ReturnFunction)(void*);
+    
+    // caller future waiting on an in-flight computation
+    struct Waiter {
+        Future<T>* future;
+        Waiter* next;
+        
+        Waiter(Future<T>* f) : future(f), next(nullptr) {}
+    };
+    
+    struct Entry {
+        MemoCache* cache;
+        ReturnFunction function;
+        ULONGLONG argHash;
+        ULONGLONG hash;
+        
+        bool done;           // value valid, entry is in the LRU
+        T value;
+        Future<T>* master;   // cache-owned future of the running computation (nullptr once done)
+        Waiter* waiters;
+        
+        Entry* chainNext;    // hash bucket
+        Entry* lruPrev;      // LRU list, most recent first (done entries only)
+        Entry* lruNext;
+        
+        Entry(MemoCache* c, ReturnFunction func, ULONGLONG arg, ULONGLONG h)
+            : cache(c), function(func), argHash(arg), hash(h), done(false), value(), master(nullptr),
+              waiters(nullptr), chainNext(nullptr), lruPrev(nullptr), lruNext(nullptr) {}
+    };
+    
+    static const int SHARDS = 16;
+    static const int BUCKETS_PER_SHARD = 256;
+    
+    struct Shard {
+        CRITICAL_SECTION cs;
+        Entry* buckets[BUCKETS_PER_SHARD];
+        Entry* lruHead;
+        Entry* lruTail;
+        int cached;  // done entries
+    };
+    
+    Scheduler* scheduler;
+    int shardCapacity;
+    Shard shards[SHARDS];
+    
+    volatile LONG hits;
+    volatile LONG misses;
+    volatile LONG joined;
+    volatile LONG evictions;
+    
+    static ULONGLONG hashKey(ReturnFunction function, ULONGLONG argHash) {
+        ULONGLONG h = argHash ^ ((ULONGLONG)(ULONG_PTR)function * 0x9E3779B97F4A7C15ULL);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h;
+    }
+    
+    Shard& shardOf(ULONGLONG hash) {
+        return shards[hash % SHARDS];
+    }
+    
+    static Entry** bucketOf(Shard& shard, ULONGLONG hash) {
+        return &shard.buckets[(hash / SHARDS) % BUCKETS_PER_SHARD];
+    }
+    
+    // shard lock held
+    static void unlinkChain(Shard& shard, Entry* entry) {
+        Entry** link = bucketOf(shard, entry->hash);
+        while (*link != entry) {
+            link = &(*link)->chainNext;
+        }
+        *link = entry->chainNext;
+    }
+    
+    static void lruUnlink(Shard& shard, Entry* entry) {
+        if (entry->lruPrev != nullptr) entry->lruPrev->lruNext = entry->lruNext;
+        else shard.lruHead = entry->lruNext;
+        if (entry->lruNext != nullptr) entry->lruNext->lruPrev = entry->lruPrev;
+        else shard.lruTail = entry->lruPrev;
+        entry->lruPrev = entry->lruNext = nullptr;
+    }
+    
+    static void lruPushFront(Shard& shard, Entry* entry) {
+        entry->lruPrev = nullptr;
+        entry->lruNext = shard.lruHead;
+        if (shard.lruHead != nullptr) shard.lruHead->lruPrev = entry;
+        else shard.lruTail = entry;
+        shard.lruHead = entry;
+    }
+    
+    // a waiter of a joined future lifts the shared computation
+    static void ForwardBoost(void* context, int priority) {
+        ((Future<T>*)context)->boost(priority);
+    }
+    
+    // continuation of the master future - publish the result to the cache and every waiter
+    static void ComputationDone(void* context) {
+        Entry* entry = (Entry*)context;
+        MemoCache* cache = entry->cache;
+        Shard& shard = cache->shardOf(entry->hash);
+        
+        Future<T>* master = entry->master;
+        FutureState state = master->getState();
+        T value = master->get();  // complete - returns at once
+        
+        EnterCriticalSection(&shard.cs);
+        
+        Waiter* waiters = entry->waiters;
+        entry->waiters = nullptr;
+        entry->master = nullptr;
+        
+        if (state == FUTURE_READY) {
+            entry->value = value;
+            entry->done = true;
+            lruPushFront(shard, entry);
+            shard.cached++;
+            
+            while (shard.cached > cache->shardCapacity) {
+                Entry* victim = shard.lruTail;
+                lruUnlink(shard, victim);
+                unlinkChain(shard, victim);
+                shard.cached--;
+                delete victim;
+                InterlockedIncrement(&cache->evictions);
+            }
+        } else {
+            unlinkChain(shard, entry);
+            delete entry;
+        }
+        
+        LeaveCriticalSection(&shard.cs);
+        
+        // completing a waiter clears its boost hook, so nothing reaches master after this loop
+        while (waiters != nullptr) {
+            Waiter* next = waiters->next;
+            if (state == FUTURE_READY) {
+                waiters->future->setResult(value);
+            } else {
+                waiters->future->fail(state);
+            }
+            delete waiters;
+            waiters = next;
+        }
+        
+        delete master;
+    }
+    
+public:
+    // capacity = cached results across all shards (in-flight computations are not counted)
+    MemoCache(Scheduler* s, int capacity = 4096)
+        : scheduler(s), hits(0), misses(0), joined(0), evictions(0) {
+        shardCapacity = capacity / SHARDS > 0 ? capacity / SHARDS : 1;
+        for (int i = 0; i < SHARDS; i++) {
+            InitializeCriticalSection(&shards[i].cs);
+            for (int b = 0; b < BUCKETS_PER_SHARD; b++) {
+                shards[i].buckets[b] = nullptr;
+            }
+            shards[i].lruHead = nullptr;
+            shards[i].lruTail = nullptr;
+            shards[i].cached = 0;
+        }
+    }
+    
+    // computations still in flight must have finished (destroy after the scheduler)
+    ~MemoCache() {
+        for (int i = 0; i < SHARDS; i++) {
+            for (int b = 0; b < BUCKETS_PER_SHARD; b++) {
+                Entry* entry = shards[i].buckets[b];
+                while (entry != nullptr) {
+                    Entry* next = entry->chainNext;
+                    delete entry;
+                    entry = next;
+                }
+            }
+            DeleteCriticalSection(&shards[i].cs);
+        }
+    }
+    
+    MemoCache(const MemoCache&) = delete;
+    MemoCache& operator=(const MemoCache&) = delete;
+    
+    // memoized enqueueTaskWithReturn - argHash must identify the argument's value
+    // (equal hashes are treated as equal arguments); the caller deletes the returned future
+    Future<T>* enqueue(ReturnFunction function, void* argument, ULONGLONG argHash, TaskPriority priority = MEDIUM) {
+        ULONGLONG hash = hashKey(function, argHash);
+        Shard& shard = shardOf(hash);
+        Future<T>* future = new Future<T>();
+        
+        EnterCriticalSection(&shard.cs);
+        
+        Entry** bucket = bucketOf(shard, hash);
+        Entry* entry = *bucket;
+        while (entry != nullptr && (entry->function != function || entry->argHash != argHash)) {
+            entry = entry->chainNext;
+        }
+        
+        if (entry != nullptr && entry->done) {
+            lruUnlink(shard, entry);
+            lruPushFront(shard, entry);
+            T value = entry->value;
+            LeaveCriticalSection(&shard.cs);
+            
+            InterlockedIncrement(&hits);
+            future->setResult(value);
+            return future;
+        }
+        
+        if (entry != nullptr) {
+            Waiter* waiter = new Waiter(future);
+            waiter->next = entry->waiters;
+            entry->waiters = waiter;
+            if (entry->master != nullptr) {
+                future->setBoost(ForwardBoost, entry->master);
+            }
+            LeaveCriticalSection(&shard.cs);
+            
+            InterlockedIncrement(&joined);
+            return future;
+        }
+        
+        // miss - queue the one computation for this key; the caller joins it like everyone else
+        entry = new Entry(this, function, argHash, hash);
+        entry->waiters = new Waiter(future);
+        entry->chainNext = *bucket;
+        *bucket = entry;
+        
+        LeaveCriticalSection(&shard.cs);
+        
+        // outside the lock - submit may wait for space
+        Future<T>* master = scheduler->template enqueueTaskWithReturn<T>(function, argument, priority);
+        
+        // hook up the callers that joined meanwhile (nothing completes them before onReady below)
+        EnterCriticalSection(&shard.cs);
+        entry->master = master;
+        for (Waiter* w = entry->waiters; w != nullptr; w = w->next) {
+            w->future->setBoost(ForwardBoost, master);
+        }
+        LeaveCriticalSection(&shard.cs);
+        
+        InterlockedIncrement(&misses);
+        
+        // completed already (refused, or a worker was quick) - publish now
+        if (!master->onReady(ComputationDone, entry)) {
+            ComputationDone(entry);
+        }
+        
+        return future;
+    }
+    
+    // drop every cached result (in-flight computations are unaffected)
+    void clear() {
+        for (int i = 0; i < SHARDS; i++) {
+            Shard& shard = shards[i];
+            EnterCriticalSection(&shard.cs);
+            while (shard.lruHead != nullptr) {
+                Entry* entry = shard.lruHead;
+                lruUnlink(shard, entry);
+                unlinkChain(shard, entry);
+                delete entry;
+            }
+            shard.cached = 0;
+            LeaveCriticalSection(&shard.cs);
+        }
+    }
+    
+    LONG getHits() const {
+        return hits;
+    }
+    
+    LONG getMisses() const {
+        return misses;
+    }
+    
+    // callers that shared an in-flight computation
+    LONG getJoined() const {
+        return joined;
+    }
+    
+    LONG getEvictions() const {
+        return evictions;
+    }
+    
+    int size() {
+        int total = 0;
+        for (int i = 0; i < SHARDS; i++) {
+            EnterCriticalSection(&shards[i].cs);
+            total += shards[i].cached;
+            LeaveCriticalSection(&shards[i].cs);
+        }
+        return total;
+    }
+};
+
+#endif
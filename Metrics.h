@@ -3,6 +3,11 @@
 
 #include <windows.h>
 #include <iostream>
+#include "TaskPriority.h"
+
+// forEachTenant callback - waits in milliseconds
+typedef void (*TenantVisitor)(void* context, int tenantId, LONG enqueued, LONG rejected, LONG completed,
+                              double totalWaitMs, double maxWaitMs);
 
 class Metrics {
 private:
@@ -10,6 +15,59 @@ private:
     volatile LONG totalTasksEnqueued;
     volatile LONG totalTasksCompleted;
     volatile LONG activeTasks;
+    volatile LONG totalTasksDiscarded;  // enqueued but never ran (cancelled, dropped)
+    
+    // backpressure
+    volatile LONG tasksRejected;
+    volatile LONG tasksDropped;
+    volatile LONG tasksRanOnCaller;
+    volatile LONG producerBlocks;
+    volatile LONGLONG producerBlockedTicks;
+    
+    // priority inheritance - queued producers raised to a waiter's priority
+    volatile LONG tasksBoosted;
+    
+    // keyed submissions merged into an entry for the same key that was still queued
+    volatile LONG tasksCoalesced;
+    
+    // picked by a worker over their rate limit and parked until a token was due
+    volatile LONG tasksRateLimited;
+    
+    // load shedding - stale tasks discarded per priority
+    volatile LONG shedPerLevel[PRIORITY_LEVELS];
+    
+    // queue wait per priority level (QPC ticks) - max proves nothing starves
+    volatile LONGLONG maxQueueWait[PRIORITY_LEVELS];
+    volatile LONGLONG totalQueueWait[PRIORITY_LEVELS];
+    volatile LONG dequeuedPerLevel[PRIORITY_LEVELS];
+    
+    // queue depth per priority level and its high-watermark - read without the queue lock
+    volatile LONG queueDepth[PRIORITY_LEVELS];
+    volatile LONG queueHighWater[PRIORITY_LEVELS];
+    
+    // deadline tracking - lateness histogram buckets: <1ms, <10ms, <100ms, <1s, >=1s
+    static const int LATENESS_BUCKETS = 5;
+    volatile LONG deadlinesMet;
+    volatile LONG deadlinesMissed;
+    volatile LONG latenessHistogram[LATENESS_BUCKETS];
+    volatile LONGLONG maxLateness;
+    volatile LONGLONG totalLateness;
+    
+    // per-tenant counters - append-only list, readers walk it without locking
+    struct TenantCounters {
+        int tenantId;
+        volatile LONG enqueued;
+        volatile LONG rejected;
+        volatile LONG completed;
+        volatile LONGLONG totalWait;
+        volatile LONGLONG maxWait;
+        TenantCounters* next;
+        
+        TenantCounters(int id) : tenantId(id), enqueued(0), rejected(0), completed(0),
+                                 totalWait(0), maxWait(0), next(nullptr) {}
+    };
+    
+    TenantCounters* volatile tenantsHead;
     
     // timing
     LARGE_INTEGER frequency;
@@ -18,16 +76,62 @@ private:
     CRITICAL_SECTION cs;
     
 public:
-    Metrics() : totalTasksEnqueued(0), totalTasksCompleted(0), activeTasks(0) {
+    Metrics() : totalTasksEnqueued(0), totalTasksCompleted(0), activeTasks(0), totalTasksDiscarded(0),
+                tasksRejected(0), tasksDropped(0), tasksRanOnCaller(0), producerBlocks(0), producerBlockedTicks(0),
+                tasksBoosted(0), tasksCoalesced(0), tasksRateLimited(0), deadlinesMet(0), deadlinesMissed(0), maxLateness(0),
+                totalLateness(0), tenantsHead(nullptr) {
+        for (int i = 0; i < LATENESS_BUCKETS; i++) {
+            latenessHistogram[i] = 0;
+        }
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            maxQueueWait[i] = 0;
+            totalQueueWait[i] = 0;
+            dequeuedPerLevel[i] = 0;
+            shedPerLevel[i] = 0;
+            queueDepth[i] = 0;
+            queueHighWater[i] = 0;
+        }
+        
         InitializeCriticalSection(&cs);
         QueryPerformanceFrequency(&frequency);
         QueryPerformanceCounter(&startTime);
     }
     
     ~Metrics() {
+        TenantCounters* current = tenantsHead;
+        while (current != nullptr) {
+            TenantCounters* next = current->next;
+            delete current;
+            current = next;
+        }
         DeleteCriticalSection(&cs);
     }
     
+private:
+    // lock-free lookup; creation is serialized by cs so each tenant appears once
+    TenantCounters* tenant(int tenantId) {
+        for (TenantCounters* t = tenantsHead; t != nullptr; t = t->next) {
+            if (t->tenantId == tenantId) return t;
+        }
+        
+        EnterCriticalSection(&cs);
+        
+        TenantCounters* t = tenantsHead;
+        while (t != nullptr && t->tenantId != tenantId) {
+            t = t->next;
+        }
+        if (t == nullptr) {
+            t = new TenantCounters(tenantId);
+            t->next = tenantsHead;
+            InterlockedExchangePointer((PVOID volatile*)&tenantsHead, t);  // publish after init
+        }
+        
+        LeaveCriticalSection(&cs);
+        return t;
+    }
+    
+public:
+    
     // increment counters (thread-safe using Interlocked)
     void taskEnqueued() {
         InterlockedIncrement(&totalTasksEnqueued);
@@ -42,6 +146,148 @@ public:
         InterlockedIncrement(&totalTasksCompleted);
     }
     
+    // a queued task left the queue without running (cancelled)
+    void taskDiscarded() {
+        InterlockedIncrement(&totalTasksDiscarded);
+    }
+    
+    // backpressure counters
+    void taskRejected() {
+        InterlockedIncrement(&tasksRejected);
+    }
+    
+    // evicted from a full queue - it had been enqueued, so it also counts as discarded
+    void taskDropped() {
+        InterlockedIncrement(&tasksDropped);
+        InterlockedIncrement(&totalTasksDiscarded);
+    }
+    
+    // discarded for waiting past its max queue wait
+    void taskShed(int priority) {
+        if (priority >= 0 && priority < PRIORITY_LEVELS) {
+            InterlockedIncrement(&shedPerLevel[priority]);
+        }
+        InterlockedIncrement(&totalTasksDiscarded);
+    }
+    
+    void taskRanOnCaller() {
+        InterlockedIncrement(&tasksRanOnCaller);
+    }
+    
+    // a queued task was re-queued at a higher-priority waiter's level
+    void taskBoosted() {
+        InterlockedIncrement(&tasksBoosted);
+    }
+    
+    void taskCoalesced() {
+        InterlockedIncrement(&tasksCoalesced);
+    }
+    
+    void taskRateLimited() {
+        InterlockedIncrement(&tasksRateLimited);
+    }
+    
+    void producerBlocked(LONGLONG ticks) {
+        InterlockedIncrement(&producerBlocks);
+        InterlockedExchangeAdd64(&producerBlockedTicks, ticks);
+    }
+    
+    // a task went into / came out of the queue at this priority level
+    void taskQueued(int priority) {
+        if (priority < 0 || priority >= PRIORITY_LEVELS) return;
+        
+        LONG depth = InterlockedIncrement(&queueDepth[priority]);
+        
+        // lock-free max update
+        LONG high = queueHighWater[priority];
+        while (depth > high) {
+            LONG seen = InterlockedCompareExchange(&queueHighWater[priority], depth, high);
+            if (seen == high) break;
+            high = seen;
+        }
+    }
+    
+    void taskUnqueued(int priority) {
+        if (priority < 0 || priority >= PRIORITY_LEVELS) return;
+        InterlockedDecrement(&queueDepth[priority]);
+    }
+    
+    // time a task spent queued before a worker picked it up
+    void recordQueueWait(int priority, LONGLONG ticks) {
+        if (priority < 0 || priority >= PRIORITY_LEVELS) return;
+        
+        InterlockedExchangeAdd64(&totalQueueWait[priority], ticks);
+        InterlockedIncrement(&dequeuedPerLevel[priority]);
+        
+        // lock-free max update
+        LONGLONG current = maxQueueWait[priority];
+        while (ticks > current) {
+            LONGLONG seen = InterlockedCompareExchange64(&maxQueueWait[priority], ticks, current);
+            if (seen == current) break;
+            current = seen;
+        }
+    }
+    
+    // finish time minus deadline (QPC ticks) for a task that had a deadline
+    void recordDeadline(LONGLONG latenessTicks) {
+        if (latenessTicks <= 0) {
+            InterlockedIncrement(&deadlinesMet);
+            return;
+        }
+        
+        InterlockedIncrement(&deadlinesMissed);
+        InterlockedExchangeAdd64(&totalLateness, latenessTicks);
+        
+        double ms = (double)latenessTicks * 1000.0 / frequency.QuadPart;
+        int bucket = ms < 1 ? 0 : ms < 10 ? 1 : ms < 100 ? 2 : ms < 1000 ? 3 : 4;
+        InterlockedIncrement(&latenessHistogram[bucket]);
+        
+        LONGLONG current = maxLateness;
+        while (latenessTicks > current) {
+            LONGLONG seen = InterlockedCompareExchange64(&maxLateness, latenessTicks, current);
+            if (seen == current) break;
+            current = seen;
+        }
+    }
+    
+    // per-tenant counters
+    void tenantEnqueued(int tenantId) {
+        InterlockedIncrement(&tenant(tenantId)->enqueued);
+    }
+    
+    void tenantRejected(int tenantId) {
+        InterlockedIncrement(&tenant(tenantId)->rejected);
+    }
+    
+    void tenantCompleted(int tenantId, LONGLONG waitTicks) {
+        TenantCounters* t = tenant(tenantId);
+        InterlockedIncrement(&t->completed);
+        InterlockedExchangeAdd64(&t->totalWait, waitTicks);
+        
+        LONGLONG current = t->maxWait;
+        while (waitTicks > current) {
+            LONGLONG seen = InterlockedCompareExchange64(&t->maxWait, waitTicks, current);
+            if (seen == current) break;
+            current = seen;
+        }
+    }
+    
+    LONG getTenantEnqueued(int tenantId) {
+        return tenant(tenantId)->enqueued;
+    }
+    
+    LONG getTenantRejected(int tenantId) {
+        return tenant(tenantId)->rejected;
+    }
+    
+    LONG getTenantCompleted(int tenantId) {
+        return tenant(tenantId)->completed;
+    }
+    
+    double getTenantMaxWaitMs(int tenantId) {
+        return (double)tenant(tenantId)->maxWait * 1000.0 / frequency.QuadPart;
+    }
+    
     // getters
     LONG getTotalEnqueued() const {
         return totalTasksEnqueued;
@@ -56,7 +302,109 @@ public:
     }
     
     LONG getPendingTasks() const {
-        return totalTasksEnqueued - totalTasksCompleted;
+        return totalTasksEnqueued - totalTasksCompleted - totalTasksDiscarded;
+    }
+    
+    LONG getTotalDiscarded() const {
+        return totalTasksDiscarded;
+    }
+    
+    LONG getRejected() const {
+        return tasksRejected;
+    }
+    
+    LONG getDropped() const {
+        return tasksDropped;
+    }
+    
+    LONG getRanOnCaller() const {
+        return tasksRanOnCaller;
+    }
+    
+    LONG getBoosted() const {
+        return tasksBoosted;
+    }
+    
+    LONG getCoalesced() const {
+        return tasksCoalesced;
+    }
+    
+    LONG getRateLimited() const {
+        return tasksRateLimited;
+    }
+    
+    LONG getShed(int priority) const {
+        return shedPerLevel[priority];
+    }
+    
+    double getProducerBlockedMs() const {
+        return (double)producerBlockedTicks * 1000.0 / frequency.QuadPart;
+    }
+    
+    double getMaxQueueWaitMs(int priority) const {
+        return (double)maxQueueWait[priority] * 1000.0 / frequency.QuadPart;
+    }
+    
+    double getAvgQueueWaitMs(int priority) const {
+        LONG n = dequeuedPerLevel[priority];
+        if (n == 0) return 0;
+        return (double)totalQueueWait[priority] * 1000.0 / frequency.QuadPart / n;
+    }
+    
+    // tasks of this priority picked up by a worker, and their summed queue wait
+    LONG getDequeued(int priority) const {
+        return dequeuedPerLevel[priority];
+    }
+    
+    double getTotalQueueWaitMs(int priority) const {
+        return (double)totalQueueWait[priority] * 1000.0 / frequency.QuadPart;
+    }
+    
+    // tasks queued at this priority level right now (superseded boost copies included until dequeued)
+    LONG getQueueDepth(int priority) const {
+        return queueDepth[priority];
+    }
+    
+    // most tasks ever queued at once at this priority level
+    LONG getQueueHighWater(int priority) const {
+        return queueHighWater[priority];
+    }
+    
+    // start a new high-watermark window from the current depth
+    void resetQueueHighWater() {
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            InterlockedExchange(&queueHighWater[i], queueDepth[i]);
+        }
+    }
+    
+    LONG getDeadlinesMet() const {
+        return deadlinesMet;
+    }
+    
+    LONG getDeadlinesMissed() const {
+        return deadlinesMissed;
+    }
+    
+    // misses whose lateness fell in bucket: 0 <1ms, 1 <10ms, 2 <100ms, 3 <1s, 4 >=1s
+    LONG getLatenessBucket(int bucket) const {
+        return latenessHistogram[bucket];
+    }
+    
+    double getMaxLatenessMs() const {
+        return (double)maxLateness * 1000.0 / frequency.QuadPart;
+    }
+    
+    double getTotalLatenessMs() const {
+        return (double)totalLateness * 1000.0 / frequency.QuadPart;
+    }
+    
+    // visit every tenant's counters without locking (the list is append-only)
+    void forEachTenant(TenantVisitor visitor, void* context) const {
+        for (TenantCounters* t = tenantsHead; t != nullptr; t = t->next) {
+            visitor(context, t->tenantId, t->enqueued, t->rejected, t->completed,
+                    (double)t->totalWait * 1000.0 / frequency.QuadPart,
+                    (double)t->maxWait * 1000.0 / frequency.QuadPart);
+        }
     }
     
     // calculate throughput (tasks per second)
@@ -88,6 +436,68 @@ public:
         std::cout << "Pending Tasks:   " << getPendingTasks() << std::endl;
         std::cout << "Throughput:      " << getThroughput() << " tasks/sec" << std::endl;
         std::cout << "Elapsed Time:    " << getElapsedTime() << " sec" << std::endl;
+        
+        if (totalTasksDiscarded > 0) {
+            std::cout << "Discarded:       " << totalTasksDiscarded << std::endl;
+        }
+        if (tasksRejected + tasksDropped + tasksRanOnCaller + producerBlocks > 0) {
+            std::cout << "Rejected:        " << tasksRejected << std::endl;
+            std::cout << "Dropped (LOW):   " << tasksDropped << std::endl;
+            std::cout << "Ran On Caller:   " << tasksRanOnCaller << std::endl;
+            std::cout << "Producer Blocked:" << producerBlocks << " times, " << getProducerBlockedMs() << " ms" << std::endl;
+        }
+        
+        if (tasksBoosted > 0) {
+            std::cout << "Boosted:         " << tasksBoosted << std::endl;
+        }
+        if (tasksCoalesced > 0) {
+            std::cout << "Coalesced:       " << tasksCoalesced << std::endl;
+        }
+        if (tasksRateLimited > 0) {
+            std::cout << "Rate Limited:    " << tasksRateLimited << std::endl;
+        }
+        
+        LONG totalShed = 0;
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            totalShed += shedPerLevel[i];
+        }
+        if (totalShed > 0) {
+            std::cout << "Shed (stale):    " << totalShed << std::endl;
+            for (int i = PRIORITY_LEVELS - 1; i >= 0; i--) {
+                std::cout << "  " << priorityName(i) << ": " << shedPerLevel[i] << std::endl;
+            }
+        }
+        
+        std::cout << "Queue Depth (now / high):" << std::endl;
+        for (int i = PRIORITY_LEVELS - 1; i >= 0; i--) {
+            std::cout << "  " << priorityName(i) << ": " << queueDepth[i] << " / " << queueHighWater[i] << std::endl;
+        }
+        
+        std::cout << "Queue Wait (avg / max ms):" << std::endl;
+        for (int i = PRIORITY_LEVELS - 1; i >= 0; i--) {
+            std::cout << "  " << priorityName(i) << ": " << getAvgQueueWaitMs(i)
+                      << " / " << getMaxQueueWaitMs(i) << std::endl;
+        }
+        
+        if (deadlinesMet + deadlinesMissed > 0) {
+            const char* bucketNames[LATENESS_BUCKETS] = { "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+            std::cout << "Deadlines Met:   " << deadlinesMet << std::endl;
+            std::cout << "Deadline Misses: " << deadlinesMissed << " (max late " << getMaxLatenessMs() << " ms)" << std::endl;
+            for (int i = 0; i < LATENESS_BUCKETS; i++) {
+                std::cout << "  late " << bucketNames[i] << ": " << latenessHistogram[i] << std::endl;
+            }
+        }
+        if (tenantsHead != nullptr) {
+            std::cout << "Tenants (enqueued / rejected / completed / avg wait ms / max wait ms):" << std::endl;
+            for (TenantCounters* t = tenantsHead; t != nullptr; t = t->next) {
+                double avgWait = t->completed == 0 ? 0 :
+                    (double)t->totalWait * 1000.0 / frequency.QuadPart / t->completed;
+                std::cout << "  tenant " << t->tenantId << ": " << t->enqueued << " / " << t->rejected
+                          << " / " << t->completed << " / " << avgWait << " / "
+                          << (double)t->maxWait * 1000.0 / frequency.QuadPart << std::endl;
+            }
+        }
+        
         std::cout << "===============\n" << std::endl;
         
         LeaveCriticalSection((LPCRITICAL_SECTION)&cs);
@@ -0,0 +1,326 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <winsock2.h>
+#include <windows.h>
+#include "TaskScheduler.h"
+
+#pragma comment(lib, "ws2_32.lib")
+
+// serves the scheduler's metrics in Prometheus text exposition format (version 0.0.4)
+// on http://127.0.0.1:<port>/metrics from one background thread
+// everything it reads is an atomic counter or a worker's own clock - a scrape never takes a
+// lock a worker needs
+template<typename Scheduler>
+class MetricsExporter {
+private:
+    // growable text buffer for one response
+    class Text {
+    private:
+        char* data;
+        int length;
+        int capacity;
+        
+    public:
+        Text() : length(0), capacity(16384) {
+            data = new char[capacity];
+            data[0] = '\0';
+        }
+        
+        ~Text() {
+            delete[] data;
+        }
+        
+        void append(const char* text) {
+            int n = (int)strlen(text);
+            if (length + n + 1 > capacity) {
+                while (length + n + 1 > capacity) capacity *= 2;
+                char* bigger = new char[capacity];
+                memcpy(bigger, data, length + 1);
+                delete[] data;
+                data = bigger;
+            }
+            memcpy(data + length, text, n + 1);
+            length += n;
+        }
+        
+        const char* str() const { return data; }
+        int size() const { return length; }
+    };
+    
+    Scheduler* scheduler;
+    USHORT port;
+    SOCKET listener;
+    HANDLE serverThread;
+    volatile bool stopping;
+    volatile LONG scrapes;
+    
+    static void header(Text& out, const char* name, const char* type, const char* help) {
+        char line[256];
+        sprintf_s(line, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+        out.append(line);
+    }
+    
+    static void sample(Text& out, const char* name, const char* labels, double value) {
+        char line[256];
+        if (labels != nullptr) {
+            sprintf_s(line, "%s{%s} %.9g\n", name, labels, value);
+        } else {
+            sprintf_s(line, "%s %.9g\n", name, value);
+        }
+        out.append(line);
+    }
+    
+    static void metric(Text& out, const char* name, const char* type, const char* help, double value) {
+        header(out, name, type, help);
+        sample(out, name, nullptr, value);
+    }
+    
+    // forEachTenant visitors - one pass per metric family (a family's samples must be contiguous)
+    static void TenantTaskSamples(void* context, int tenantId, LONG enqueued, LONG rejected, LONG completed,
+                                  double, double) {
+        Text& out = *(Text*)context;
+        char labels[64];
+        sprintf_s(labels, "tenant=\"%d\",event=\"enqueued\"", tenantId);
+        sample(out, "taskscheduler_tenant_tasks_total", labels, enqueued);
+        sprintf_s(labels, "tenant=\"%d\",event=\"rejected\"", tenantId);
+        sample(out, "taskscheduler_tenant_tasks_total", labels, rejected);
+        sprintf_s(labels, "tenant=\"%d\",event=\"completed\"", tenantId);
+        sample(out, "taskscheduler_tenant_tasks_total", labels, completed);
+    }
+    
+    static void TenantWaitSamples(void* context, int tenantId, LONG, LONG, LONG, double totalWaitMs, double) {
+        Text& out = *(Text*)context;
+        char labels[64];
+        sprintf_s(labels, "tenant=\"%d\"", tenantId);
+        sample(out, "taskscheduler_tenant_queue_wait_seconds_total", labels, totalWaitMs / 1000.0);
+    }
+    
+    void render(Text& out) {
+        Metrics& m = scheduler->getMetrics();
+        char labels[64];
+        
+        // counters
+        metric(out, "taskscheduler_tasks_enqueued_total", "counter", "Tasks accepted into the queue.", m.getTotalEnqueued());
+        metric(out, "taskscheduler_tasks_completed_total", "counter", "Tasks that ran to completion.", m.getTotalCompleted());
+        metric(out, "taskscheduler_tasks_discarded_total", "counter", "Tasks dropped without running.", m.getTotalDiscarded());
+        metric(out, "taskscheduler_tasks_rejected_total", "counter", "Submissions refused by a full queue.", m.getRejected());
+        metric(out, "taskscheduler_tasks_dropped_total", "counter", "Queued LOW tasks evicted by drop-oldest.", m.getDropped());
+        metric(out, "taskscheduler_tasks_ran_on_caller_total", "counter", "Tasks run on the producer by caller-runs.", m.getRanOnCaller());
+        metric(out, "taskscheduler_tasks_boosted_total", "counter", "Queued tasks raised to a waiter's priority.", m.getBoosted());
+        metric(out, "taskscheduler_tasks_coalesced_total", "counter", "Keyed submissions merged into a queued entry.", m.getCoalesced());
+        metric(out, "taskscheduler_tasks_rate_limited_total", "counter", "Tasks parked over their rate limit.", m.getRateLimited());
+        metric(out, "taskscheduler_producer_blocked_seconds_total", "counter", "Time producers waited for queue space.",
+               m.getProducerBlockedMs() / 1000.0);
+        
+        header(out, "taskscheduler_tasks_shed_total", "counter", "Tasks discarded for waiting too long.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_tasks_shed_total", labels, m.getShed(i));
+        }
+        
+        header(out, "taskscheduler_tasks_dequeued_total", "counter", "Tasks picked up by a worker.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_tasks_dequeued_total", labels, m.getDequeued(i));
+        }
+        
+        header(out, "taskscheduler_queue_wait_seconds_total", "counter", "Summed queue wait of dequeued tasks.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_queue_wait_seconds_total", labels, m.getTotalQueueWaitMs(i) / 1000.0);
+        }
+        
+        header(out, "taskscheduler_queue_wait_max_seconds", "gauge", "Longest queue wait seen.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_queue_wait_max_seconds", labels, m.getMaxQueueWaitMs(i) / 1000.0);
+        }
+        
+        // deadline lateness histogram (misses only) - buckets are cumulative
+        metric(out, "taskscheduler_deadlines_met_total", "counter", "Deadline tasks that finished in time.", m.getDeadlinesMet());
+        header(out, "taskscheduler_deadline_lateness_seconds", "histogram", "How late deadline misses finished.");
+        const char* bounds[] = { "0.001", "0.01", "0.1", "1", "+Inf" };
+        LONG cumulative = 0;
+        for (int i = 0; i < 5; i++) {
+            cumulative += m.getLatenessBucket(i);
+            sprintf_s(labels, "le=\"%s\"", bounds[i]);
+            sample(out, "taskscheduler_deadline_lateness_seconds_bucket", labels, cumulative);
+        }
+        sample(out, "taskscheduler_deadline_lateness_seconds_sum", nullptr, m.getTotalLatenessMs() / 1000.0);
+        sample(out, "taskscheduler_deadline_lateness_seconds_count", nullptr, cumulative);
+        
+        // gauges
+        metric(out, "taskscheduler_queue_depth", "gauge", "Tasks waiting in the queue.", scheduler->getQueuedTasks());
+        header(out, "taskscheduler_queue_depth_by_priority", "gauge", "Tasks waiting per priority level.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_queue_depth_by_priority", labels, m.getQueueDepth(i));
+        }
+        header(out, "taskscheduler_queue_depth_high_water", "gauge", "Most tasks waiting at once per priority level.");
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            sprintf_s(labels, "priority=\"%s\"", priorityName(i));
+            sample(out, "taskscheduler_queue_depth_high_water", labels, m.getQueueHighWater(i));
+        }
+        metric(out, "taskscheduler_active_tasks", "gauge", "Tasks running on workers now.", m.getActiveTasks());
+        metric(out, "taskscheduler_spinning_workers", "gauge", "Idle workers spinning for work.", scheduler->getSpinningWorkers());
+        metric(out, "taskscheduler_workers", "gauge", "Worker and spare threads started.", scheduler->getWorkerCount());
+        
+        // worker time per state, pool-wide and per worker
+        static const char* stateNames[WORKER_STATES] = { "running", "spinning", "parked", "queue", "overhead" };
+        header(out, "taskscheduler_worker_state_ratio", "gauge", "Share of worker time per state since start.");
+        WorkerUtilization pool = scheduler->getPoolUtilization();
+        for (int s = 0; s < WORKER_STATES; s++) {
+            sprintf_s(labels, "worker=\"pool\",state=\"%s\"", stateNames[s]);
+            sample(out, "taskscheduler_worker_state_ratio", labels, pool.percent((WorkerState)s) / 100.0);
+        }
+        int workers = scheduler->getWorkerCount();
+        for (int w = 0; w < workers; w++) {
+            WorkerUtilization u = scheduler->getWorkerUtilization(w);
+            for (int s = 0; s < WORKER_STATES; s++) {
+                sprintf_s(labels, "worker=\"%d\",state=\"%s\"", w, stateNames[s]);
+                sample(out, "taskscheduler_worker_state_ratio", labels, u.percent((WorkerState)s) / 100.0);
+            }
+        }
+        
+        header(out, "taskscheduler_tenant_tasks_total", "counter", "Per-tenant task counts.");
+        m.forEachTenant(TenantTaskSamples, &out);
+        header(out, "taskscheduler_tenant_queue_wait_seconds_total", "counter", "Per-tenant summed queue wait.");
+        m.forEachTenant(TenantWaitSamples, &out);
+        
+        metric(out, "taskscheduler_uptime_seconds", "gauge", "Seconds since the scheduler started.", m.getElapsedTime());
+    }
+    
+    void serve(SOCKET client) {
+        DWORD timeoutMs = 1000;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
+        
+        // read the request head - only the request line matters
+        char request[2048];
+        int received = 0;
+        while (received < (int)sizeof(request) - 1) {
+            int n = recv(client, request + received, (int)sizeof(request) - 1 - received, 0);
+            if (n <= 0) break;
+            received += n;
+            request[received] = '\0';
+            if (strstr(request, "\r\n\r\n") != nullptr) break;
+        }
+        request[received] = '\0';
+        
+        Text body;
+        const char* status;
+        const char* contentType;
+        if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET / ", 6) == 0) {
+            render(body);
+            status = "200 OK";
+            contentType = "text/plain; version=0.0.4; charset=utf-8";
+            InterlockedIncrement(&scrapes);
+        } else {
+            body.append("not found\n");
+            status = "404 Not Found";
+            contentType = "text/plain";
+        }
+        
+        char head[256];
+        int headLength = sprintf_s(head, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+                                   status, contentType, body.size());
+        sendAll(client, head, headLength);
+        sendAll(client, body.str(), body.size());
+    }
+    
+    static void sendAll(SOCKET s, const char* data, int length) {
+        while (length > 0) {
+            int n = send(s, data, length, 0);
+            if (n <= 0) return;
+            data += n;
+            length -= n;
+        }
+    }
+    
+    static DWORD WINAPI ServerThreadFunction(LPVOID param) {
+        MetricsExporter* exporter = (MetricsExporter*)param;
+        
+        while (!exporter->stopping) {
+            SOCKET client = accept(exporter->listener, nullptr, nullptr);
+            if (client == INVALID_SOCKET) {
+                if (exporter->stopping) break;
+                Sleep(10);  // transient (out of resources) - don't spin
+                continue;
+            }
+            exporter->serve(client);
+            closesocket(client);
+        }
+        return 0;
+    }
+    
+public:
+    MetricsExporter(Scheduler* s)
+        : scheduler(s), port(0), listener(INVALID_SOCKET), serverThread(NULL), stopping(false), scrapes(0) {
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    }
+    
+    ~MetricsExporter() {
+        stop();
+        WSACleanup();
+    }
+    
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    
+    // listen on 127.0.0.1:listenPort (0 = any free port, see getPort) - false if it cannot bind
+    bool start(USHORT listenPort = 9464) {
+        if (serverThread != NULL) return true;
+        
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == INVALID_SOCKET) return false;
+        
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // loopback only - never exposed
+        address.sin_port = htons(listenPort);
+        
+        if (bind(listener, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+            listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+            closesocket(listener);
+            listener = INVALID_SOCKET;
+            globalLogger.error("MetricsExporter: cannot listen on the requested port");
+            return false;
+        }
+        
+        int length = sizeof(address);
+        getsockname(listener, (sockaddr*)&address, &length);
+        port = ntohs(address.sin_port);
+        
+        stopping = false;
+        serverThread = CreateThread(NULL, 0, ServerThreadFunction, this, 0, NULL);
+        
+        char msg[128];
+        sprintf_s(msg, "MetricsExporter serving http://127.0.0.1:%u/metrics", port);
+        globalLogger.info(msg);
+        return true;
+    }
+    
+    // closing the listener wakes the blocked accept
+    void stop() {
+        if (serverThread == NULL) return;
+        
+        stopping = true;
+        closesocket(listener);
+        WaitForSingleObject(serverThread, INFINITE);
+        CloseHandle(serverThread);
+        serverThread = NULL;
+        listener = INVALID_SOCKET;
+    }
+    
+    USHORT getPort() const {
+        return port;
+    }
+    
+    LONG getScrapes() const {
+        return scrapes;
+    }
+};
+
+#endif
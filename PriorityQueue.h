@@ -2,8 +2,30 @@
 #define PRIORITY_QUEUE_H
 
 #include <windows.h>
+#include "IdleStrategy.h"
+#include "TaskPriority.h"
 
-template<typename T>
+// priority aging - a queued item gains one level for every intervalMs[level] it waits
+struct AgingPolicy {
+    DWORD intervalMs[PRIORITY_LEVELS];  // 0 = items of this level never age
+    int maxPriority;                    // aged priority never goes above this
+    
+    AgingPolicy() : maxPriority(CRITICAL) {
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            intervalMs[i] = 0;
+        }
+    }
+    
+    AgingPolicy(DWORD lowMs, DWORD mediumMs, DWORD highMs, int cap = CRITICAL) : maxPriority(cap) {
+        intervalMs[LOW] = lowMs;
+        intervalMs[MEDIUM] = mediumMs;
+        intervalMs[HIGH] = highMs;
+        intervalMs[CRITICAL] = 0;
+    }
+};
+
+// T needs 'priority' (0..Levels-1), 'enqueueTime' (QueryPerformanceCounter ticks) and 'admitted'
+template<typename T, int Levels = PRIORITY_LEVELS>
 class PriorityQueue {
 private:
     struct Node {
@@ -13,80 +35,186 @@ private:
         Node(const T& value) : data(value), next(nullptr) {}
     };
     
-    Node* head;
-    int count;
+    // one FIFO list per priority level - O(1) enqueue, O(Levels) dequeue
+    struct Bucket {
+        Node* head;
+        Node* tail;
+        
+        Bucket() : head(nullptr), tail(nullptr) {}
+    };
+    
+    Bucket buckets[Levels];
+    volatile LONG count;  // read lock-free by spinning workers
+    
+    // aging - per-level interval in QPC ticks (0 = off)
+    LONGLONG agingTicks[Levels];
+    int agingCap;
+    LARGE_INTEGER frequency;
     
     CRITICAL_SECTION cs;
     CONDITION_VARIABLE notEmpty;
-    bool isShutdown;
+    volatile bool isShutdown;
+    IdleState idle;
+    
+    static int clampLevel(int priority) {
+        if (priority < 0) return 0;
+        if (priority >= Levels) return Levels - 1;
+        return priority;
+    }
+    
+    // pick the bucket whose head has the highest effective (aged) priority
+    // ties go to the item that has waited longest
+    int pickLevel() {
+        LARGE_INTEGER now;
+        bool haveNow = false;
+        
+        int bestLevel = -1;
+        int bestPriority = -1;
+        LONGLONG bestTime = 0;
+        
+        for (int level = Levels - 1; level >= 0; level--) {
+            Node* node = buckets[level].head;
+            if (node == nullptr) {
+                continue;
+            }
+            
+            int effective = level;
+            if (agingTicks[level] > 0 && level < agingCap) {
+                if (!haveNow) {
+                    QueryPerformanceCounter(&now);
+                    haveNow = true;
+                }
+                LONGLONG waited = now.QuadPart - node->data.enqueueTime;
+                LONGLONG boost = waited > 0 ? waited / agingTicks[level] : 0;
+                effective = (level + boost >= agingCap) ? agingCap : level + (int)boost;
+            }
+            
+            if (effective > bestPriority ||
+                (effective == bestPriority && node->data.enqueueTime < bestTime)) {
+                bestLevel = level;
+                bestPriority = effective;
+                bestTime = node->data.enqueueTime;
+            }
+        }
+        
+        return bestLevel;
+    }
+    
+    // unlink the next item to run (under cs, count > 0)
+    Node* takeNext() {
+        Bucket& bucket = buckets[pickLevel()];
+        Node* temp = bucket.head;
+        bucket.head = temp->next;
+        if (bucket.head == nullptr) {
+            bucket.tail = nullptr;
+        }
+        count--;
+        return temp;
+    }
     
 public:
-    PriorityQueue() : head(nullptr), count(0), isShutdown(false) {
+    PriorityQueue() : count(0), agingCap(Levels - 1), isShutdown(false) {
         InitializeCriticalSection(&cs);
         InitializeConditionVariable(&notEmpty);
+        QueryPerformanceFrequency(&frequency);
+        
+        for (int i = 0; i < Levels; i++) {
+            agingTicks[i] = 0;
+        }
     }
     
     ~PriorityQueue() {
         EnterCriticalSection(&cs);
         
-        while (head != nullptr) {
-            Node* temp = head;
-            head = head->next;
-            delete temp;
+        for (int i = 0; i < Levels; i++) {
+            while (buckets[i].head != nullptr) {
+                Node* temp = buckets[i].head;
+                buckets[i].head = buckets[i].head->next;
+                delete temp;
+            }
         }
         
         LeaveCriticalSection(&cs);
         DeleteCriticalSection(&cs);
     }
     
-    // enqueue - insert based on priority
+    // enqueue - append to the FIFO of its priority level
     void enqueue(const T& value) {
-        EnterCriticalSection(&cs);
-        
         Node* newNode = new Node(value);
+        int level = clampLevel(value.priority);
         
-        // if the list is empty or new node has higher priority than head
-        if (head == nullptr || value.priority > head->data.priority) {
-            newNode->next = head;
-            head = newNode;
+        EnterCriticalSection(&cs);
+        
+        Bucket& bucket = buckets[level];
+        if (bucket.tail == nullptr) {
+            bucket.head = bucket.tail = newNode;
         } else {
-            // find the correct position to insert
-            Node* current = head;
-            while (current->next != nullptr && 
-                   current->next->data.priority >= value.priority) {
-                current = current->next;
-            }
-            newNode->next = current->next;
-            current->next = newNode;
+            bucket.tail->next = newNode;
+            bucket.tail = newNode;
         }
         
         count++;
-        WakeConditionVariable(&notEmpty);
         
         LeaveCriticalSection(&cs);
+        
+        // wake outside the lock, and only if no worker is already spinning for work
+        if (idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
     }
     
-    // dequeue - remove highest priority item
+    // dequeue - remove highest (effective) priority item
     bool dequeue(T& outValue) {
+        // spin/yield before paying for a kernel sleep + wake round trip
+        if (count == 0 && !isShutdown) {
+            idle.spinForWork(&count, &isShutdown);
+        }
+        
         EnterCriticalSection(&cs);
         
-        while (head == nullptr && !isShutdown) {
+        while (count == 0 && !isShutdown) {
+            idle.parking();
             SleepConditionVariableCS(&notEmpty, &cs, INFINITE);
+            idle.unparked();
         }
         
-        if (isShutdown && head == nullptr) {
+        if (isShutdown && count == 0) {
             LeaveCriticalSection(&cs);
             return false;
         }
         
-        Node* temp = head;
-        outValue = head->data;
-        head = head->next;
+        Node* temp = takeNext();
+        outValue = temp->data;
+        LONG remaining = count;
+        
+        LeaveCriticalSection(&cs);
         
         delete temp;
-        count--;
+        
+        // pass the baton - a producer may have skipped the wake while we were spinning
+        if (remaining > 0 && idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+    
+    // non-blocking dequeue - false if nothing is queued (waiters helping out use this)
+    bool tryDequeue(T& outValue) {
+        if (count == 0) return false;
+        
+        EnterCriticalSection(&cs);
+        
+        if (count == 0) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        Node* temp = takeNext();
+        outValue = temp->data;
         
         LeaveCriticalSection(&cs);
+        
+        delete temp;
         return true;
     }
     
@@ -97,12 +225,68 @@ public:
         LeaveCriticalSection(&cs);
     }
     
-    int size() {
+    // remove the oldest queued item of one priority level (overflow drop policy)
+    // admitted items are never evicted - they are stepped over
+    bool evictOldest(int priority, T& outValue) {
         EnterCriticalSection(&cs);
-        int sz = count;
+        
+        Bucket& bucket = buckets[clampLevel(priority)];
+        Node* prev = nullptr;
+        Node* temp = bucket.head;
+        while (temp != nullptr && temp->data.admitted) {
+            prev = temp;
+            temp = temp->next;
+        }
+        if (temp == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        outValue = temp->data;
+        if (prev == nullptr) {
+            bucket.head = temp->next;
+        } else {
+            prev->next = temp->next;
+        }
+        if (bucket.tail == temp) {
+            bucket.tail = prev;
+        }
+        count--;
+        
+        LeaveCriticalSection(&cs);
+        
+        delete temp;
+        return true;
+    }
+    
+    // policy hook - called when a dequeued task is done (nothing to track here)
+    void taskFinished(const T&) {}
+    
+    void setIdleStrategy(const IdleStrategy& strategy) {
+        idle.setStrategy(strategy);
+    }
+    
+    LONG getSpinningWorkers() const {
+        return idle.getSpinningWorkers();
+    }
+    
+    // configure priority aging (all intervals 0 = strict priority)
+    void setAging(const AgingPolicy& policy) {
+        EnterCriticalSection(&cs);
+        
+        for (int i = 0; i < Levels; i++) {
+            DWORD ms = (i < PRIORITY_LEVELS) ? policy.intervalMs[i] : 0;
+            agingTicks[i] = (LONGLONG)ms * frequency.QuadPart / 1000;
+        }
+        agingCap = clampLevel(policy.maxPriority);
+        
         LeaveCriticalSection(&cs);
-        return sz;
+    }
+    
+    // lock-free snapshot - count is an aligned volatile LONG, so the read is atomic
+    int size() const {
+        return count;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
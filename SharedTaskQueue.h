@@ -0,0 +1,630 @@
+#ifndef SHARED_TASK_QUEUE_H
+#define SHARED_TASK_QUEUE_H
+
+#include <windows.h>
+#include <string.h>
+#include <stdio.h>
+#include "TaskScheduler.h"
+#include "Logger.h"
+
+// task body for the shared queue - function pointers differ per process, so tasks travel as
+// a registered function id plus argument bytes
+typedef void (*SharedTaskFunction)(const void* data, DWORD length);
+
+// priority task queue in a named shared-memory section, used by several processes at once
+// every process opens it by name; producers enqueue, consumers (SharedQueueConsumer) drain it
+// into their own scheduler, so load spreads over all worker processes on the host
+// synchronization is a named mutex: a process that dies holding it leaves it abandoned, and the
+// next owner rebuilds the lists from the slot states (each slot's state is its commit point)
+// a dequeued slot stays claimed by its process until the task is done - claims of dead
+// processes are put back at the front of their level (recoverOrphans)
+class SharedTaskQueue {
+private:
+    static const DWORD QUEUE_MAGIC = 0x51485354;  // "TSHQ"
+    static const LONG NONE = -1;
+    
+    enum SlotState {
+        SLOT_FREE,
+        SLOT_QUEUED,
+        SLOT_CLAIMED
+    };
+    
+    // the section starts with the header, followed by 'capacity' slots of 'slotStride' bytes
+    // links are slot indexes - each process maps the section at its own address
+    struct Header {
+        volatile DWORD magic;  // written last by the creator
+        LONG capacity;
+        DWORD maxArgBytes;
+        DWORD slotStride;
+        LONG levelHead[PRIORITY_LEVELS];
+        LONG levelTail[PRIORITY_LEVELS];
+        LONG freeHead;
+        volatile LONG queued[PRIORITY_LEVELS];  // read without the lock
+        volatile LONG claimed;
+        volatile LONG recovered;
+        ULONGLONG nextSequence;
+    };
+    
+    struct Slot {
+        volatile LONG state;   // SlotState
+        LONG next;             // level list or free list
+        LONG priority;
+        DWORD functionId;
+        DWORD length;
+        DWORD ownerPid;        // claiming process
+        ULONGLONG ownerStart;  // its creation time - a reused pid is not mistaken for the owner
+        ULONGLONG sequence;    // enqueue order, for rebuilding the lists
+    };
+    
+    HANDLE mapping;
+    HANDLE mutex;
+    HANDLE items;  // named semaphore, roughly the queued count - consumers wait on it
+    Header* header;
+    DWORD processId;
+    ULONGLONG processStart;
+    
+    static DWORD align8(DWORD bytes) {
+        return (bytes + 7) & ~7u;
+    }
+    
+    static ULONGLONG creationTime(HANDLE process) {
+        FILETIME created, exited, kernel, user;
+        if (!GetProcessTimes(process, &created, &exited, &kernel, &user)) return 0;
+        return ((ULONGLONG)created.dwHighDateTime << 32) | created.dwLowDateTime;
+    }
+    
+    // is the process that claimed a slot still running?
+    static bool isAlive(DWORD pid, ULONGLONG start) {
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, pid);
+        if (process == NULL) {
+            return GetLastError() == ERROR_ACCESS_DENIED;  // exists, but belongs to someone else
+        }
+        bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT && creationTime(process) == start;
+        CloseHandle(process);
+        return alive;
+    }
+    
+    Slot* slotAt(LONG index) const {
+        return (Slot*)((BYTE*)header + align8(sizeof(Header)) + (SIZE_T)index * header->slotStride);
+    }
+    
+    static BYTE* payloadOf(Slot* slot) {
+        return (BYTE*)slot + align8(sizeof(Slot));
+    }
+    
+    // lock held
+    void pushBack(LONG index) {
+        Slot* slot = slotAt(index);
+        slot->next = NONE;
+        LONG level = slot->priority;
+        if (header->levelTail[level] == NONE) {
+            header->levelHead[level] = index;
+        } else {
+            slotAt(header->levelTail[level])->next = index;
+        }
+        header->levelTail[level] = index;
+    }
+    
+    void pushFront(LONG index) {
+        Slot* slot = slotAt(index);
+        LONG level = slot->priority;
+        slot->next = header->levelHead[level];
+        header->levelHead[level] = index;
+        if (header->levelTail[level] == NONE) {
+            header->levelTail[level] = index;
+        }
+    }
+    
+    // the previous owner died holding the lock - the lists may be half-updated, the slot
+    // states are not: rebuild lists and counters from them (queued slots in sequence order)
+    void repair() {
+        for (int level = 0; level < PRIORITY_LEVELS; level++) {
+            header->levelHead[level] = NONE;
+            header->levelTail[level] = NONE;
+            header->queued[level] = 0;
+        }
+        header->freeHead = NONE;
+        header->claimed = 0;
+        
+        // insertion into the level lists by sequence - a recovery path, capacity is modest
+        for (LONG i = header->capacity - 1; i >= 0; i--) {
+            Slot* slot = slotAt(i);
+            if (slot->state == SLOT_FREE) {
+                slot->next = header->freeHead;
+                header->freeHead = i;
+            } else if (slot->state == SLOT_CLAIMED) {
+                header->claimed++;
+            } else {
+                LONG level = slot->priority;
+                LONG* link = &header->levelHead[level];
+                while (*link != NONE && slotAt(*link)->sequence < slot->sequence) {
+                    link = &slotAt(*link)->next;
+                }
+                slot->next = *link;
+                *link = i;
+                if (slot->next == NONE) {
+                    header->levelTail[level] = i;
+                }
+                header->queued[level]++;
+            }
+        }
+        
+        globalLogger.warning("Shared queue: previous lock owner died - lists rebuilt");
+    }
+    
+    // WAIT_ABANDONED still hands us the mutex - repair before anything reads the lists
+    bool lock() {
+        DWORD result = WaitForSingleObject(mutex, INFINITE);
+        if (result == WAIT_ABANDONED) {
+            repair();
+            requeueOrphans();
+            return true;
+        }
+        return result == WAIT_OBJECT_0;
+    }
+    
+    void unlock() {
+        ReleaseMutex(mutex);
+    }
+    
+    // lock held - claims of processes that have exited go back to the front of their level
+    LONG requeueOrphans() {
+        // collect newest first (linked through 'next', unused while claimed), so pushing each
+        // to the front leaves them in their original order ahead of everything queued
+        LONG orphans = NONE;
+        LONG count = 0;
+        for (LONG i = 0; i < header->capacity; i++) {
+            Slot* slot = slotAt(i);
+            if (slot->state != SLOT_CLAIMED || isAlive(slot->ownerPid, slot->ownerStart)) {
+                continue;
+            }
+            LONG* link = &orphans;
+            while (*link != NONE && slotAt(*link)->sequence > slot->sequence) {
+                link = &slotAt(*link)->next;
+            }
+            slot->next = *link;
+            *link = i;
+            count++;
+        }
+        
+        while (orphans != NONE) {
+            Slot* slot = slotAt(orphans);
+            LONG next = slot->next;
+            slot->state = SLOT_QUEUED;
+            pushFront(orphans);
+            header->queued[slot->priority]++;
+            header->claimed--;
+            orphans = next;
+        }
+        
+        if (count > 0) {
+            header->recovered += count;
+            ReleaseSemaphore(items, count, NULL);
+        }
+        return count;
+    }
+    
+    void initialize(LONG capacity, DWORD maxArgBytes) {
+        header->capacity = capacity;
+        header->maxArgBytes = maxArgBytes;
+        header->slotStride = align8(sizeof(Slot)) + align8(maxArgBytes);
+        for (int level = 0; level < PRIORITY_LEVELS; level++) {
+            header->levelHead[level] = NONE;
+            header->levelTail[level] = NONE;
+            header->queued[level] = 0;
+        }
+        header->claimed = 0;
+        header->recovered = 0;
+        header->nextSequence = 0;
+        
+        header->freeHead = NONE;
+        for (LONG i = capacity - 1; i >= 0; i--) {
+            Slot* slot = slotAt(i);
+            slot->state = SLOT_FREE;
+            slot->next = header->freeHead;
+            header->freeHead = i;
+        }
+        
+        MemoryBarrier();
+        header->magic = QUEUE_MAGIC;
+    }
+    
+    static void objectName(char* buffer, size_t size, const char* name, const char* suffix) {
+        sprintf_s(buffer, size, "%s.%s", name, suffix);
+    }
+    
+public:
+    SharedTaskQueue() : mapping(NULL), mutex(NULL), items(NULL), header(nullptr), processStart(0) {
+        processId = GetCurrentProcessId();
+        processStart = creationTime(GetCurrentProcess());
+    }
+    
+    ~SharedTaskQueue() {
+        close();
+    }
+    
+    SharedTaskQueue(const SharedTaskQueue&) = delete;
+    SharedTaskQueue& operator=(const SharedTaskQueue&) = delete;
+    
+    // create the queue, or attach to it if another process already did (its sizes then apply)
+    // name is a kernel object name, e.g. "Local\\ImageJobs" (session) or "Global\\ImageJobs"
+    bool open(const char* name, LONG capacity = 4096, DWORD maxArgBytes = 256) {
+        char objectNameBuffer[MAX_PATH];
+        
+        close();  // reopening - let go of the previous queue's handles
+        
+        objectName(objectNameBuffer, sizeof(objectNameBuffer), name, "lock");
+        mutex = CreateMutexA(NULL, FALSE, objectNameBuffer);
+        objectName(objectNameBuffer, sizeof(objectNameBuffer), name, "items");
+        items = CreateSemaphoreA(NULL, 0, 0x7FFFFFFF, objectNameBuffer);
+        if (mutex == NULL || items == NULL) {
+            close();
+            return false;
+        }
+        
+        // creator and attachers serialize on the lock, so nobody sees a half-built section
+        bool abandoned = WaitForSingleObject(mutex, INFINITE) == WAIT_ABANDONED;
+        
+        ULONGLONG bytes = align8(sizeof(Header)) +
+                          (ULONGLONG)capacity * (align8(sizeof(Slot)) + align8(maxArgBytes));
+        objectName(objectNameBuffer, sizeof(objectNameBuffer), name, "map");
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                     (DWORD)(bytes >> 32), (DWORD)bytes, objectNameBuffer);
+        bool existed = GetLastError() == ERROR_ALREADY_EXISTS;
+        if (mapping != NULL) {
+            header = (Header*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);  // whole section
+        }
+        
+        bool ok = header != nullptr;
+        if (ok && !existed) {
+            initialize(capacity, maxArgBytes);
+        } else if (ok && header->magic != QUEUE_MAGIC) {
+            ok = false;  // not a queue, or its creator died while building it
+        } else if (ok && abandoned) {
+            repair();
+        }
+        
+        ReleaseMutex(mutex);
+        
+        if (!ok) {
+            close();
+            return false;
+        }
+        
+        // claims left by processes that died since the last run
+        recoverOrphans();
+        return true;
+    }
+    
+    void close() {
+        if (header != nullptr) UnmapViewOfFile(header);
+        if (mapping != NULL) CloseHandle(mapping);
+        if (mutex != NULL) CloseHandle(mutex);
+        if (items != NULL) CloseHandle(items);
+        header = nullptr;
+        mapping = mutex = items = NULL;
+    }
+    
+    // false if the queue is full or the argument is larger than maxArgBytes
+    bool enqueue(DWORD functionId, const void* data, DWORD length, TaskPriority priority = MEDIUM) {
+        if (header == nullptr || length > header->maxArgBytes) return false;
+        if (priority < 0 || priority >= PRIORITY_LEVELS) priority = MEDIUM;
+        if (!lock()) return false;
+        
+        LONG index = header->freeHead;
+        if (index == NONE) {
+            unlock();
+            return false;
+        }
+        
+        Slot* slot = slotAt(index);
+        header->freeHead = slot->next;
+        
+        if (length > 0) {
+            memcpy(payloadOf(slot), data, length);
+        }
+        slot->functionId = functionId;
+        slot->length = length;
+        slot->priority = priority;
+        slot->sequence = header->nextSequence++;
+        MemoryBarrier();
+        slot->state = SLOT_QUEUED;  // commit point
+        
+        pushBack(index);
+        header->queued[priority]++;
+        
+        unlock();
+        
+        ReleaseSemaphore(items, 1, NULL);
+        return true;
+    }
+    
+    // claim the highest-priority task (FIFO within a level) for this process
+    // returns the slot index, -1 if the queue is empty; finish with complete() or release()
+    LONG tryDequeue() {
+        if (header == nullptr || !lock()) return NONE;
+        
+        LONG index = NONE;
+        for (int level = PRIORITY_LEVELS - 1; level >= 0; level--) {
+            index = header->levelHead[level];
+            if (index == NONE) continue;
+            
+            Slot* slot = slotAt(index);
+            slot->ownerPid = processId;
+            slot->ownerStart = processStart;
+            MemoryBarrier();
+            slot->state = SLOT_CLAIMED;  // commit point
+            
+            header->levelHead[level] = slot->next;
+            if (header->levelHead[level] == NONE) {
+                header->levelTail[level] = NONE;
+            }
+            header->queued[level]--;
+            header->claimed++;
+            break;
+        }
+        
+        unlock();
+        return index;
+    }
+    
+    // wait up to timeoutMs for a task, then try to claim one
+    LONG dequeue(DWORD timeoutMs) {
+        if (header == nullptr) return NONE;
+        WaitForSingleObject(items, timeoutMs);  // a hint - the count drifts when processes die
+        return tryDequeue();
+    }
+    
+    // a claimed task's data - valid until complete() or release()
+    DWORD getFunctionId(LONG index) const {
+        return slotAt(index)->functionId;
+    }
+    
+    const void* getData(LONG index) const {
+        return payloadOf(slotAt(index));
+    }
+    
+    DWORD getLength(LONG index) const {
+        return slotAt(index)->length;
+    }
+    
+    TaskPriority getPriority(LONG index) const {
+        return (TaskPriority)slotAt(index)->priority;
+    }
+    
+    // claimed task is done - free its slot
+    void complete(LONG index) {
+        if (!lock()) return;
+        
+        Slot* slot = slotAt(index);
+        slot->state = SLOT_FREE;  // commit point
+        slot->next = header->freeHead;
+        header->freeHead = index;
+        header->claimed--;
+        
+        unlock();
+    }
+    
+    // hand a claimed task back to the front of its level (this process could not run it)
+    void release(LONG index) {
+        if (!lock()) return;
+        
+        Slot* slot = slotAt(index);
+        slot->state = SLOT_QUEUED;
+        pushFront(index);
+        header->queued[slot->priority]++;
+        header->claimed--;
+        
+        unlock();
+        
+        ReleaseSemaphore(items, 1, NULL);
+    }
+    
+    // put the claims of exited processes back in the queue - consumers call this periodically
+    LONG recoverOrphans() {
+        if (header == nullptr || !lock()) return 0;
+        LONG count = requeueOrphans();
+        unlock();
+        return count;
+    }
+    
+    // lock-free snapshots (all processes)
+    LONG getQueued(int priority) const {
+        return header != nullptr ? header->queued[priority] : 0;
+    }
+    
+    LONG getQueuedTotal() const {
+        LONG total = 0;
+        for (int level = 0; level < PRIORITY_LEVELS; level++) {
+            total += getQueued(level);
+        }
+        return total;
+    }
+    
+    LONG getClaimed() const {
+        return header != nullptr ? header->claimed : 0;
+    }
+    
+    // tasks taken back from processes that died before finishing them
+    LONG getRecovered() const {
+        return header != nullptr ? header->recovered : 0;
+    }
+};
+
+// drains a SharedTaskQueue into this process's scheduler
+// at most maxInFlight shared tasks are claimed here at once, so an idle process takes work
+// and a busy one leaves it for the others
+template<typename Scheduler>
+class SharedQueueConsumer {
+private:
+    static const int MAX_FUNCTIONS = 256;
+    static const DWORD POLL_MS = 50;       // wait for new tasks before looking again
+    static const DWORD RECOVERY_MS = 500;  // how often dead processes' claims are looked for
+    
+    struct Job {
+        SharedQueueConsumer* consumer;
+        LONG slot;
+    };
+    
+    SharedTaskQueue* queue;
+    Scheduler* scheduler;
+    LONG maxInFlight;
+    SharedTaskFunction functions[MAX_FUNCTIONS];
+    
+    volatile LONG inFlight;
+    volatile LONG executed;
+    bool backoff;  // the scheduler refused a task - pause before claiming again (under cs)
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE slotFree;
+    HANDLE pumpThread;
+    bool stopping;
+    
+    static void RunJob(void* arg) {
+        Job* job = (Job*)arg;
+        SharedQueueConsumer* consumer = job->consumer;
+        SharedTaskQueue* queue = consumer->queue;
+        
+        SharedTaskFunction function = consumer->functions[queue->getFunctionId(job->slot)];
+        function(queue->getData(job->slot), queue->getLength(job->slot));
+        
+        queue->complete(job->slot);
+        InterlockedIncrement(&consumer->executed);
+        consumer->finished(job);
+    }
+    
+    // refused locally - another process may have room; cancelled or shed - dropped for good
+    static void DiscardJob(void* arg, FutureState reason) {
+        Job* job = (Job*)arg;
+        bool refused = reason == FUTURE_REJECTED;
+        if (refused) {
+            job->consumer->queue->release(job->slot);
+        } else {
+            job->consumer->queue->complete(job->slot);
+        }
+        job->consumer->finished(job, refused);
+    }
+    
+    void finished(Job* job, bool refused = false) {
+        delete job;
+        EnterCriticalSection(&cs);
+        inFlight--;
+        if (refused) {
+            backoff = true;
+        }
+        WakeConditionVariable(&slotFree);
+        LeaveCriticalSection(&cs);
+    }
+    
+    static DWORD WINAPI PumpThreadFunction(LPVOID param) {
+        SharedQueueConsumer* consumer = (SharedQueueConsumer*)param;
+        SharedTaskQueue* queue = consumer->queue;
+        ULONGLONG lastRecovery = GetTickCount64();
+        
+        while (true) {
+            EnterCriticalSection(&consumer->cs);
+            while (!consumer->stopping && consumer->inFlight >= consumer->maxInFlight) {
+                SleepConditionVariableCS(&consumer->slotFree, &consumer->cs, POLL_MS);
+            }
+            // a refused task went back to the front of the shared queue - claiming it straight
+            // back would spin on the cross-process lock; wait for one of ours to finish (or a poll)
+            if (consumer->backoff && !consumer->stopping) {
+                consumer->backoff = false;
+                SleepConditionVariableCS(&consumer->slotFree, &consumer->cs, POLL_MS);
+            }
+            bool stop = consumer->stopping;
+            LeaveCriticalSection(&consumer->cs);
+            if (stop) break;
+            
+            ULONGLONG now = GetTickCount64();
+            if (now - lastRecovery >= RECOVERY_MS) {
+                queue->recoverOrphans();
+                lastRecovery = now;
+            }
+            
+            LONG slot = queue->dequeue(POLL_MS);
+            if (slot < 0) continue;
+            
+            DWORD functionId = queue->getFunctionId(slot);
+            if (functionId >= MAX_FUNCTIONS || consumer->functions[functionId] == nullptr) {
+                globalLogger.logf(LOG_WARNING, "Shared queue: no function registered for id %lu - task dropped",
+                                  functionId);
+                queue->complete(slot);
+                continue;
+            }
+            
+            Job* job = new Job();
+            job->consumer = consumer;
+            job->slot = slot;
+            
+            EnterCriticalSection(&consumer->cs);
+            consumer->inFlight++;
+            LeaveCriticalSection(&consumer->cs);
+            
+            Task task(RunJob, job, queue->getPriority(slot));
+            task.onDiscard = DiscardJob;
+            task.profileKey = (void*)consumer->functions[functionId];
+            consumer->scheduler->submitTask(task);
+        }
+        return 0;
+    }
+    
+public:
+    // maxInFlight = shared tasks claimed by this process at once (about its worker count)
+    SharedQueueConsumer(SharedTaskQueue* q, Scheduler* s, LONG inFlightLimit)
+        : queue(q), scheduler(s), maxInFlight(inFlightLimit > 0 ? inFlightLimit : 1), inFlight(0), executed(0),
+          backoff(false), pumpThread(NULL), stopping(false) {
+        for (int i = 0; i < MAX_FUNCTIONS; i++) {
+            functions[i] = nullptr;
+        }
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&slotFree);
+    }
+    
+    // claimed tasks must have finished (destroy after the scheduler)
+    ~SharedQueueConsumer() {
+        stop();
+        DeleteCriticalSection(&cs);
+    }
+    
+    SharedQueueConsumer(const SharedQueueConsumer&) = delete;
+    SharedQueueConsumer& operator=(const SharedQueueConsumer&) = delete;
+    
+    // register before start() - every process must use the same ids
+    bool registerFunction(DWORD id, SharedTaskFunction function) {
+        if (id >= MAX_FUNCTIONS) return false;
+        functions[id] = function;
+        return true;
+    }
+    
+    void start() {
+        if (pumpThread == NULL) {
+            stopping = false;
+            pumpThread = CreateThread(NULL, 0, PumpThreadFunction, this, 0, NULL);
+        }
+    }
+    
+    // stop claiming new tasks (claimed ones still run on the scheduler)
+    void stop() {
+        if (pumpThread == NULL) return;
+        
+        EnterCriticalSection(&cs);
+        stopping = true;
+        WakeConditionVariable(&slotFree);
+        LeaveCriticalSection(&cs);
+        
+        WaitForSingleObject(pumpThread, INFINITE);
+        CloseHandle(pumpThread);
+        pumpThread = NULL;
+    }
+    
+    LONG getInFlight() const {
+        return inFlight;
+    }
+    
+    LONG getExecuted() const {
+        return executed;
+    }
+};
+
+#endif
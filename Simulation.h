@@ -0,0 +1,396 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <windows.h>
+#include <iostream>
+#include "TaskScheduler.h"
+#include "WorkloadTrace.h"
+
+// outcome of a simulation run (virtual time)
+struct SimResults {
+    LONG completed;
+    LONG rejected;                       // refused by the queue policy (tenant caps)
+    double makespanMs;                   // virtual time when the last task finished
+    double utilization;                  // busy worker time / (workers * makespan)
+    LONG dequeued[PRIORITY_LEVELS];
+    double avgWaitMs[PRIORITY_LEVELS];
+    double maxWaitMs[PRIORITY_LEVELS];
+    LONG deadlinesMet;
+    LONG deadlinesMissed;
+    double maxLatenessMs;
+};
+
+// deterministic single-threaded scheduler simulation - the same queue policies as
+// BasicTaskScheduler, driven by a virtual clock and a fixed number of virtual workers
+// a task occupies a worker for its cost in virtual time; tasks submitted with a function run
+// it inline (on the calling thread) when they start, so they can submit follow-up work
+// events at the same instant (finishes, and which idle worker takes the next task) are ordered
+// by a seeded generator - the same seed, workload and policy give the same schedule every run
+// replay() feeds a recorded WorkloadTrace, so one production trace can be compared across
+// policies and worker counts offline
+// priority aging reads the real clock - leave it off here
+template<typename QueuePolicy>
+class SimScheduler {
+private:
+    // what a queued task carries (Task.argument)
+    struct SimJob {
+        TaskFunction function;  // nullptr for replayed tasks - they only take time
+        void* argument;
+        LONGLONG costTicks;
+    };
+    
+    struct Arrival {
+        LONGLONG time;
+        LONGLONG seq;  // submission order among equal times
+        Task task;
+        Arrival* next;
+    };
+    
+    struct SimWorker {
+        bool busy;
+        LONGLONG busyUntil;
+        LONGLONG busyTicks;
+        Task task;
+    };
+    
+    QueuePolicy taskQueue;
+    SimWorker* workers;
+    int workerCount;
+    int* scratch;  // worker indexes for same-instant ordering
+    
+    // virtual time in QPC ticks, so deadlines and EDF windows mean what they do live
+    LARGE_INTEGER frequency;
+    LONGLONG clock;
+    LONGLONG lastFinish;
+    
+    Arrival* arrivalsHead;  // sorted by (time, seq)
+    Arrival* arrivalsTail;
+    LONGLONG nextSeq;
+    
+    ULONGLONG rngState;
+    
+    // results
+    LONG completed;
+    LONG rejected;
+    LONG dequeued[PRIORITY_LEVELS];
+    LONGLONG totalWait[PRIORITY_LEVELS];
+    LONGLONG maxWait[PRIORITY_LEVELS];
+    LONG deadlinesMet;
+    LONG deadlinesMissed;
+    LONGLONG maxLateness;
+    
+    static void NoFunction(void*) {}
+    
+    // xorshift64*
+    ULONGLONG nextRandom() {
+        rngState ^= rngState >> 12;
+        rngState ^= rngState << 25;
+        rngState ^= rngState >> 27;
+        return rngState * 0x2545F4914F6CDD1DULL;
+    }
+    
+    int randomBelow(int n) {
+        return (int)(nextRandom() % (ULONGLONG)n);
+    }
+    
+    LONGLONG usToTicks(LONGLONG us) const {
+        return us * frequency.QuadPart / 1000000;
+    }
+    
+    double ticksToMs(LONGLONG ticks) const {
+        return (double)ticks * 1000.0 / frequency.QuadPart;
+    }
+    
+    void addArrival(LONGLONG time, const Task& task) {
+        Arrival* arrival = new Arrival();
+        arrival->time = time;
+        arrival->seq = nextSeq++;
+        arrival->task = task;
+        arrival->next = nullptr;
+        
+        // replayed traces arrive in order - append; later submissions insert in place
+        if (arrivalsTail == nullptr || arrivalsTail->time <= time) {
+            if (arrivalsTail == nullptr) arrivalsHead = arrival;
+            else arrivalsTail->next = arrival;
+            arrivalsTail = arrival;
+            return;
+        }
+        
+        Arrival** link = &arrivalsHead;
+        while ((*link)->time <= time) {
+            link = &(*link)->next;
+        }
+        arrival->next = *link;
+        *link = arrival;
+    }
+    
+    void arrive(Arrival* arrival) {
+        Task& task = arrival->task;
+        task.enqueueTime = clock;
+        if (!QueueAdmission<QueuePolicy>::enqueue(taskQueue, task)) {
+            rejected++;
+            delete (SimJob*)task.argument;
+        }
+    }
+    
+    void start(int w, Task& task) {
+        SimWorker& worker = workers[w];
+        SimJob* job = (SimJob*)task.argument;
+        
+        int level = (task.priority < 0 || task.priority >= PRIORITY_LEVELS) ? MEDIUM : task.priority;
+        LONGLONG waited = clock - task.enqueueTime;
+        dequeued[level]++;
+        totalWait[level] += waited;
+        if (waited > maxWait[level]) maxWait[level] = waited;
+        
+        worker.busy = true;
+        worker.busyUntil = clock + job->costTicks;
+        worker.task = task;
+        
+        if (job->function != nullptr) {
+            job->function(job->argument);
+        }
+    }
+    
+    void finish(int w) {
+        SimWorker& worker = workers[w];
+        Task& task = worker.task;
+        SimJob* job = (SimJob*)task.argument;
+        
+        worker.busy = false;
+        worker.busyTicks += job->costTicks;
+        lastFinish = clock;
+        completed++;
+        
+        if (task.deadline != 0) {
+            LONGLONG lateness = clock - task.deadline;
+            if (lateness <= 0) {
+                deadlinesMet++;
+            } else {
+                deadlinesMissed++;
+                if (lateness > maxLateness) maxLateness = lateness;
+            }
+        }
+        
+        taskQueue.taskFinished(task);
+        delete job;
+    }
+    
+    // hand queued tasks to idle workers, a seeded-random idle worker each
+    void dispatch() {
+        int idle = 0;
+        for (int w = 0; w < workerCount; w++) {
+            if (!workers[w].busy) scratch[idle++] = w;
+        }
+        
+        while (idle > 0) {
+            Task task;
+            if (!taskQueue.tryDequeue(task)) break;
+            
+            int pick = randomBelow(idle);
+            int w = scratch[pick];
+            scratch[pick] = scratch[--idle];
+            start(w, task);
+        }
+    }
+    
+    // earliest pending event, false if there is none
+    bool nextEventTime(LONGLONG& time) const {
+        bool found = false;
+        if (arrivalsHead != nullptr) {
+            time = arrivalsHead->time;
+            found = true;
+        }
+        for (int w = 0; w < workerCount; w++) {
+            if (workers[w].busy && (!found || workers[w].busyUntil < time)) {
+                time = workers[w].busyUntil;
+                found = true;
+            }
+        }
+        return found;
+    }
+    
+public:
+    // workers = virtual worker threads; seed fixes the order of same-instant events
+    SimScheduler(int numWorkers, ULONGLONG seed = 1)
+        : workerCount(numWorkers), clock(0), lastFinish(0), arrivalsHead(nullptr), arrivalsTail(nullptr),
+          nextSeq(0), rngState(seed != 0 ? seed : 1) {
+        workers = new SimWorker[workerCount];
+        scratch = new int[workerCount];
+        for (int w = 0; w < workerCount; w++) {
+            workers[w].busy = false;
+            workers[w].busyUntil = 0;
+            workers[w].busyTicks = 0;
+        }
+        QueryPerformanceFrequency(&frequency);
+        reset();
+    }
+    
+    ~SimScheduler() {
+        while (arrivalsHead != nullptr) {
+            Arrival* next = arrivalsHead->next;
+            delete (SimJob*)arrivalsHead->task.argument;
+            delete arrivalsHead;
+            arrivalsHead = next;
+        }
+        Task task;
+        while (taskQueue.tryDequeue(task)) {
+            delete (SimJob*)task.argument;
+        }
+        for (int w = 0; w < workerCount; w++) {
+            if (workers[w].busy) delete (SimJob*)workers[w].task.argument;
+        }
+        delete[] workers;
+        delete[] scratch;
+    }
+    
+    SimScheduler(const SimScheduler&) = delete;
+    SimScheduler& operator=(const SimScheduler&) = delete;
+    
+    // policy settings (tenants, fair-share weights, EDF windows) - configure before running
+    QueuePolicy& getQueue() {
+        return taskQueue;
+    }
+    
+    // submit delayUs from now (virtual); the task holds a worker for costUs once it starts
+    // function may be nullptr (the task only takes time); deadlineUs is relative to arrival, 0 = none
+    void submit(TaskFunction function, void* argument, TaskPriority priority, LONGLONG costUs,
+                LONGLONG delayUs = 0, LONGLONG deadlineUs = 0, int tenantId = 0) {
+        SimJob* job = new SimJob();
+        job->function = function;
+        job->argument = argument;
+        job->costTicks = usToTicks(costUs);
+        
+        Task task(NoFunction, job, priority);
+        task.tenantId = tenantId;
+        task.profileKey = (void*)function;
+        
+        LONGLONG arrival = clock + usToTicks(delayUs > 0 ? delayUs : 0);
+        if (deadlineUs != 0) {
+            task.deadline = arrival + usToTicks(deadlineUs);
+        }
+        addArrival(arrival, task);
+    }
+    
+    // queue a recorded workload; speedup > 1 compresses arrival times (more load, same tasks)
+    void replay(const WorkloadTrace& trace, double speedup = 1.0) {
+        LONG count = trace.size();
+        for (LONG i = 0; i < count; i++) {
+            const WorkloadRecord& r = trace.get(i);
+            int level = (r.priority < 0 || r.priority >= PRIORITY_LEVELS) ? MEDIUM : r.priority;
+            LONGLONG delayUs = (LONGLONG)(r.submitUs / speedup) - nowUs();
+            submit(nullptr, nullptr, (TaskPriority)level, r.durationUs, delayUs > 0 ? delayUs : 0, r.deadlineUs,
+                   r.tenantId);
+        }
+    }
+    
+    // process events until none remain, or until virtual time untilUs (-1 = no limit)
+    void run(LONGLONG untilUs = -1) {
+        LONGLONG limit = untilUs >= 0 ? usToTicks(untilUs) : -1;
+        
+        LONGLONG time = 0;
+        while (nextEventTime(time)) {
+            if (limit >= 0 && time > limit) {
+                clock = limit;
+                return;
+            }
+            clock = time;
+            
+            // finishes at this instant, in seeded order (it decides who runs next under tenant caps)
+            int done = 0;
+            for (int w = 0; w < workerCount; w++) {
+                if (workers[w].busy && workers[w].busyUntil == clock) scratch[done++] = w;
+            }
+            for (int i = done - 1; i > 0; i--) {
+                int j = randomBelow(i + 1);
+                int swap = scratch[i];
+                scratch[i] = scratch[j];
+                scratch[j] = swap;
+            }
+            for (int i = 0; i < done; i++) {
+                finish(scratch[i]);
+            }
+            
+            while (arrivalsHead != nullptr && arrivalsHead->time == clock) {
+                Arrival* arrival = arrivalsHead;
+                arrivalsHead = arrival->next;
+                if (arrivalsHead == nullptr) arrivalsTail = nullptr;
+                arrive(arrival);
+                delete arrival;
+            }
+            
+            dispatch();
+        }
+    }
+    
+    // current virtual time
+    LONGLONG nowUs() const {
+        return clock * 1000000 / frequency.QuadPart;
+    }
+    
+    // clear the results (keeps the clock and anything still pending)
+    void reset() {
+        completed = 0;
+        rejected = 0;
+        deadlinesMet = 0;
+        deadlinesMissed = 0;
+        maxLateness = 0;
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            dequeued[i] = 0;
+            totalWait[i] = 0;
+            maxWait[i] = 0;
+        }
+    }
+    
+    SimResults getResults() const {
+        SimResults r;
+        r.completed = completed;
+        r.rejected = rejected;
+        r.makespanMs = ticksToMs(lastFinish);
+        
+        LONGLONG busy = 0;
+        for (int w = 0; w < workerCount; w++) {
+            busy += workers[w].busyTicks;
+        }
+        r.utilization = lastFinish > 0 ? (double)busy / ((double)lastFinish * workerCount) : 0;
+        
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            r.dequeued[i] = dequeued[i];
+            r.avgWaitMs[i] = dequeued[i] > 0 ? ticksToMs(totalWait[i]) / dequeued[i] : 0;
+            r.maxWaitMs[i] = ticksToMs(maxWait[i]);
+        }
+        r.deadlinesMet = deadlinesMet;
+        r.deadlinesMissed = deadlinesMissed;
+        r.maxLatenessMs = ticksToMs(maxLateness);
+        return r;
+    }
+    
+    void printResults(const char* title = "SIMULATION") const {
+        SimResults r = getResults();
+        
+        std::cout << "\n=== " << title << " (" << workerCount << " workers) ===" << std::endl;
+        std::cout << "Completed:       " << r.completed << std::endl;
+        if (r.rejected > 0) {
+            std::cout << "Rejected:        " << r.rejected << std::endl;
+        }
+        std::cout << "Makespan:        " << r.makespanMs << " ms (virtual)" << std::endl;
+        std::cout << "Utilization:     " << r.utilization * 100.0 << "%" << std::endl;
+        std::cout << "Queue Wait (avg / max ms):" << std::endl;
+        for (int i = PRIORITY_LEVELS - 1; i >= 0; i--) {
+            std::cout << "  " << priorityName(i) << ": " << r.avgWaitMs[i] << " / " << r.maxWaitMs[i] << std::endl;
+        }
+        if (r.deadlinesMet + r.deadlinesMissed > 0) {
+            std::cout << "Deadlines Met:   " << r.deadlinesMet << std::endl;
+            std::cout << "Deadline Misses: " << r.deadlinesMissed << " (max late " << r.maxLatenessMs << " ms)" << std::endl;
+        }
+        std::cout << "===============\n" << std::endl;
+    }
+};
+
+typedef SimScheduler< PriorityQueue<Task> >   SimTaskScheduler;
+typedef SimScheduler< ThreadSafeQueue<Task> > SimFifoTaskScheduler;
+typedef SimScheduler< DeadlineQueue<Task> >   SimEdfTaskScheduler;
+typedef SimScheduler< FairQueue<Task> >       SimFairTaskScheduler;
+typedef SimScheduler< TenantQueue<Task> >     SimTenantTaskScheduler;
+
+#endif
@@ -0,0 +1,257 @@
+#ifndef STRAND_H
+#define STRAND_H
+
+#include <windows.h>
+#include "TaskScheduler.h"
+
+// serial executor: jobs posted to a strand run one at a time, in FIFO order, on whichever
+// worker is free - state owned by the strand needs no lock and no worker ever waits on a sibling
+// producers never lock: a multi-producer queue plus a pending count; the producer that takes
+// the count from 0 to 1 schedules a drain task, which runs jobs until the count is back to 0
+// a strand holds at most one queue slot, so its drain is admitted past capacity and the
+// overflow policy - jobs never run on a producer - and, once queued, is never evicted or shed:
+// one drain stands for every job behind it
+template<typename Scheduler>
+class Strand {
+private:
+    struct Node {
+        TaskFunction function;
+        void* argument;
+        Node* volatile next;
+        
+        Node(TaskFunction func, void* arg) : function(func), argument(arg), next(nullptr) {}
+    };
+    
+    static const int DRAIN_BATCH = 64;  // jobs per drain before yielding the worker to other tasks
+    
+    Scheduler* scheduler;
+    Node* volatile head;    // producers append here
+    Node* tail;             // drain side - the node before the next job (stub)
+    volatile LONG pending;  // jobs posted and not yet run
+    TaskPriority priority;  // of the submission that woke the strand - kept for re-queued drains
+    DiscardFunction jobDiscard;  // called with the argument of each dropped job, nullptr = none
+    
+    Task drainTask() {
+        Task task(DrainTask, this, priority);
+        task.onDiscard = DrainDiscard;
+        return task;
+    }
+    
+    // take the next job - pending > 0 guarantees one is at least being linked in
+    Node* popJob() {
+        Node* stub = tail;
+        Node* next = stub->next;
+        while (next == nullptr) {
+            YieldProcessor();  // producer between its exchange and the link
+            next = stub->next;
+        }
+        tail = next;
+        delete stub;
+        return next;  // now the stub; its job fields are still valid
+    }
+    
+    static void DrainTask(void* arg) {
+        Strand* strand = (Strand*)arg;
+        
+        for (int i = 0; i < DRAIN_BATCH; i++) {
+            Node* job = strand->popJob();
+            job->function(job->argument);
+            
+            // last job done - the strand may be destroyed from here on
+            if (InterlockedDecrement(&strand->pending) == 0) {
+                return;
+            }
+        }
+        
+        // more queued - go to the back of the scheduler queue so other work gets a turn
+        strand->scheduler->submitAdmittedTask(strand->drainTask());
+    }
+    
+    // the drain never runs - only at scheduler shutdown (a drain parked by a rate limit); drop
+    // the jobs it stood for, each handed to the job discard hook
+    static void DrainDiscard(void* arg, FutureState reason) {
+        Strand* strand = (Strand*)arg;
+        LONG dropped = 0;
+        do {
+            Node* job = strand->popJob();
+            if (strand->jobDiscard != nullptr) {
+                strand->jobDiscard(job->argument, reason);
+            }
+            dropped++;
+        } while (InterlockedDecrement(&strand->pending) != 0);
+        
+        char msg[128];
+        sprintf_s(msg, "Strand drain dropped at shutdown (state %d) - %ld jobs not run", (int)reason, dropped);
+        globalLogger.warning(msg);
+    }
+    
+public:
+    Strand(Scheduler* s) : scheduler(s), pending(0), priority(MEDIUM), jobDiscard(nullptr) {
+        Node* stub = new Node(nullptr, nullptr);
+        head = stub;
+        tail = stub;
+    }
+    
+    // wait for posted jobs first (or destroy only once the owner knows they are done)
+    ~Strand() {
+        while (tail != nullptr) {
+            Node* next = tail->next;
+            delete tail;
+            tail = next;
+        }
+    }
+    
+    Strand(const Strand&) = delete;
+    Strand& operator=(const Strand&) = delete;
+    
+    // queue a job behind everything already posted to this strand
+    // priority applies when the job wakes an idle strand
+    void post(TaskFunction function, void* argument = nullptr, TaskPriority priority = MEDIUM) {
+        Node* node = new Node(function, argument);
+        Node* prev = (Node*)InterlockedExchangePointer((PVOID volatile*)&head, node);
+        prev->next = node;
+        
+        // only the waking producer writes priority - no drain is running at that point
+        if (InterlockedIncrement(&pending) == 1) {
+            this->priority = priority;
+            scheduler->submitAdmittedTask(drainTask());
+        }
+    }
+    
+    // called with the argument of every job dropped at scheduler shutdown - set before posting
+    void setJobDiscard(DiscardFunction discard) {
+        jobDiscard = discard;
+    }
+    
+    // jobs posted and not yet finished (0 = idle)
+    LONG getPending() const {
+        return pending;
+    }
+};
+
+// strands created on demand per key - same key runs serially, different keys in parallel
+// sharded map, so producers for unrelated keys rarely touch the same lock
+template<typename Scheduler>
+class KeyedStrands {
+private:
+    static const int SHARDS = 16;
+    static const int BUCKETS_PER_SHARD = 64;
+    
+    struct Entry {
+        ULONGLONG key;
+        Strand<Scheduler>* strand;
+        Entry* next;
+        
+        Entry(ULONGLONG k, Strand<Scheduler>* s) : key(k), strand(s), next(nullptr) {}
+    };
+    
+    struct Shard {
+        CRITICAL_SECTION cs;
+        Entry* buckets[BUCKETS_PER_SHARD];
+        int strands;
+    };
+    
+    Scheduler* scheduler;
+    Shard shards[SHARDS];
+    DiscardFunction jobDiscard;
+    
+    static ULONGLONG mix(ULONGLONG key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+    
+public:
+    KeyedStrands(Scheduler* s) : scheduler(s), jobDiscard(nullptr) {
+        for (int i = 0; i < SHARDS; i++) {
+            InitializeCriticalSection(&shards[i].cs);
+            for (int b = 0; b < BUCKETS_PER_SHARD; b++) {
+                shards[i].buckets[b] = nullptr;
+            }
+            shards[i].strands = 0;
+        }
+    }
+    
+    ~KeyedStrands() {
+        for (int i = 0; i < SHARDS; i++) {
+            for (int b = 0; b < BUCKETS_PER_SHARD; b++) {
+                Entry* e = shards[i].buckets[b];
+                while (e != nullptr) {
+                    Entry* next = e->next;
+                    delete e->strand;
+                    delete e;
+                    e = next;
+                }
+            }
+            DeleteCriticalSection(&shards[i].cs);
+        }
+    }
+    
+    // run after every job already submitted for 'key'
+    void enqueue(ULONGLONG key, TaskFunction function, void* argument = nullptr, TaskPriority priority = MEDIUM) {
+        ULONGLONG h = mix(key);
+        Shard& shard = shards[h % SHARDS];
+        Entry** bucket = &shard.buckets[(h / SHARDS) % BUCKETS_PER_SHARD];
+        
+        // posting under the shard lock keeps compact() from freeing the strand under us
+        EnterCriticalSection(&shard.cs);
+        
+        Entry* e = *bucket;
+        while (e != nullptr && e->key != key) {
+            e = e->next;
+        }
+        if (e == nullptr) {
+            e = new Entry(key, new Strand<Scheduler>(scheduler));
+            e->strand->setJobDiscard(jobDiscard);
+            e->next = *bucket;
+            *bucket = e;
+            shard.strands++;
+        }
+        e->strand->post(function, argument, priority);
+        
+        LeaveCriticalSection(&shard.cs);
+    }
+    
+    // job discard hook for every strand (see Strand::setJobDiscard) - set before enqueueing
+    void setJobDiscard(DiscardFunction discard) {
+        jobDiscard = discard;
+    }
+    
+    // free the strands of keys with nothing pending - call now and then for unbounded key spaces
+    int compact() {
+        int removed = 0;
+        for (int i = 0; i < SHARDS; i++) {
+            EnterCriticalSection(&shards[i].cs);
+            for (int b = 0; b < BUCKETS_PER_SHARD; b++) {
+                Entry** link = &shards[i].buckets[b];
+                while (*link != nullptr) {
+                    Entry* e = *link;
+                    if (e->strand->getPending() == 0) {
+                        *link = e->next;
+                        delete e->strand;
+                        delete e;
+                        shards[i].strands--;
+                        removed++;
+                    } else {
+                        link = &e->next;
+                    }
+                }
+            }
+            LeaveCriticalSection(&shards[i].cs);
+        }
+        return removed;
+    }
+    
+    int getStrandCount() {
+        int total = 0;
+        for (int i = 0; i < SHARDS; i++) {
+            EnterCriticalSection(&shards[i].cs);
+            total += shards[i].strands;
+            LeaveCriticalSection(&shards[i].cs);
+        }
+        return total;
+    }
+};
+
+#endif
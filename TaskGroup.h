@@ -0,0 +1,191 @@
+#ifndef TASK_GROUP_H
+#define TASK_GROUP_H
+
+#include <windows.h>
+#include "TaskScheduler.h"
+
+// structured group of related tasks:
+//   enqueue()    - submit a member
+//   waitAll()    - wait for every member, including those of child groups
+//   cancel()     - every queued member (and child group) is skipped - one flag, no per-task scan
+//   cancellationRequested() - cooperative check for a running member
+// the destructor waits for all members, so a group outlives its tasks
+template<typename Scheduler>
+class TaskGroup {
+private:
+    // one queued member
+    struct Member {
+        TaskGroup* group;
+        TaskFunction function;
+        void* argument;
+        
+        Member(TaskGroup* g, TaskFunction func, void* arg) : group(g), function(func), argument(arg) {}
+    };
+    
+    Scheduler* scheduler;
+    TaskGroup* parent;
+    TaskGroup* firstChild;
+    TaskGroup* nextSibling;
+    
+    volatile bool cancelled;  // shared cancellation token - every member's cancelFlag points here
+    volatile LONG pending;    // members not yet finished, own and descendants'
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE allDone;
+    
+    // group of the member running on this thread (for cancellationRequested)
+    static thread_local TaskGroup* currentGroup;
+    
+    static void MemberTask(void* arg) {
+        Member* member = (Member*)arg;
+        TaskGroup* group = member->group;
+        
+        TaskGroup* outer = currentGroup;
+        currentGroup = group;
+        member->function(member->argument);
+        currentGroup = outer;
+        
+        delete member;
+        group->memberDone();
+    }
+    
+    // cancelled, shed or refused - the member still counts as finished
+    static void MemberDiscard(void* arg, FutureState) {
+        Member* member = (Member*)arg;
+        TaskGroup* group = member->group;
+        delete member;
+        group->memberDone();
+    }
+    
+    void memberAdded() {
+        for (TaskGroup* g = this; g != nullptr; g = g->parent) {
+            InterlockedIncrement(&g->pending);
+        }
+    }
+    
+    // decrement under each group's lock - a waiter may destroy the group as soon as it is released
+    void memberDone() {
+        TaskGroup* g = this;
+        while (g != nullptr) {
+            TaskGroup* up = g->parent;  // read before g can go away
+            
+            EnterCriticalSection(&g->cs);
+            if (InterlockedDecrement(&g->pending) == 0) {
+                WakeAllConditionVariable(&g->allDone);
+            }
+            LeaveCriticalSection(&g->cs);
+            
+            g = up;
+        }
+    }
+    
+    void init() {
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&allDone);
+    }
+    
+public:
+    TaskGroup(Scheduler* s)
+        : scheduler(s), parent(nullptr), firstChild(nullptr), nextSibling(nullptr), cancelled(false), pending(0) {
+        init();
+    }
+    
+    // child group - waited for by the parent's waitAll, cancelled with the parent
+    TaskGroup(TaskGroup* parentGroup)
+        : scheduler(parentGroup->scheduler), parent(parentGroup), firstChild(nullptr), nextSibling(nullptr),
+          cancelled(false), pending(0) {
+        init();
+        
+        EnterCriticalSection(&parent->cs);
+        cancelled = parent->cancelled;
+        nextSibling = parent->firstChild;
+        parent->firstChild = this;
+        LeaveCriticalSection(&parent->cs);
+    }
+    
+    ~TaskGroup() {
+        waitAll();
+        
+        if (parent != nullptr) {
+            EnterCriticalSection(&parent->cs);
+            TaskGroup** link = &parent->firstChild;
+            while (*link != this) {
+                link = &(*link)->nextSibling;
+            }
+            *link = nextSibling;
+            LeaveCriticalSection(&parent->cs);
+        }
+        
+        DeleteCriticalSection(&cs);
+    }
+    
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    
+    // submit a member - false if the scheduler refused it (it counts as finished)
+    bool enqueue(TaskFunction function, void* argument = nullptr, TaskPriority priority = MEDIUM) {
+        memberAdded();
+        
+        Task task(MemberTask, new Member(this, function, argument), priority, -1, &cancelled);
+        task.onDiscard = MemberDiscard;
+        task.profileKey = (void*)function;
+        return scheduler->submitTask(task);
+    }
+    
+    // wait until every member (and every child group's member) has finished or been discarded
+    // on a worker, runs other queued tasks meanwhile instead of sleeping
+    void waitAll() {
+        WaitHelper* helper = currentWaitHelper();
+        if (helper != nullptr) {
+            while (pending > 0) {
+                if (!helper->help(helper->context)) {
+                    EnterCriticalSection(&cs);
+                    if (pending > 0) {
+                        SleepConditionVariableCS(&allDone, &cs, 1);
+                    }
+                    LeaveCriticalSection(&cs);
+                }
+            }
+            
+            // the last memberDone may still hold cs
+            EnterCriticalSection(&cs);
+            LeaveCriticalSection(&cs);
+            return;
+        }
+        
+        EnterCriticalSection(&cs);
+        while (pending > 0) {
+            SleepConditionVariableCS(&allDone, &cs, INFINITE);
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    // queued members are skipped when dequeued; running ones can poll cancellationRequested()
+    // O(1) per group - child groups are flagged too
+    void cancel() {
+        EnterCriticalSection(&cs);
+        cancelled = true;
+        for (TaskGroup* child = firstChild; child != nullptr; child = child->nextSibling) {
+            child->cancel();
+        }
+        LeaveCriticalSection(&cs);
+    }
+    
+    bool isCancelled() const {
+        return cancelled;
+    }
+    
+    LONG getPending() const {
+        return pending;
+    }
+    
+    // for a running member: has its group been cancelled? (false outside a group task)
+    static bool cancellationRequested() {
+        return currentGroup != nullptr && currentGroup->cancelled;
+    }
+};
+
+template<typename Scheduler>
+thread_local TaskGroup<Scheduler>* TaskGroup<Scheduler>::currentGroup = nullptr;
+
+#endif
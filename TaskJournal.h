@@ -0,0 +1,542 @@
+#ifndef TASK_JOURNAL_H
+#define TASK_JOURNAL_H
+
+#include <windows.h>
+#include <string.h>
+#include <stdio.h>
+#include "TaskScheduler.h"
+#include "Logger.h"
+
+// journaled task body - gets back the argument bytes it was enqueued with
+typedef void (*JournalFunction)(const void* data, DWORD length);
+
+// durable front end for the scheduler: each task is a registered function id plus argument bytes,
+// appended to a memory-mapped journal before it is queued and marked done when it has run
+// (or been discarded); after a crash, open() queues the records that were still pending
+//   - a process crash loses nothing appended - the mapped pages belong to the OS file cache
+//   - an OS crash or power loss loses at most the last flushIntervalMs of appends
+// delivery is at-least-once: a task whose done mark had not reached the disk runs again
+// the journal is a directory of fixed-size segments; a full segment is sealed and a new one
+// started, and a sealed segment is deleted once every record in it is done
+template<typename Scheduler>
+class TaskJournal {
+private:
+    static const DWORD SEGMENT_MAGIC = 0x4C4E524A;  // "JRNL"
+    static const DWORD RECORD_MAGIC = 0x4B534154;   // "TASK"
+    static const LONG RECORD_PENDING = 1;
+    static const LONG RECORD_DONE = 2;
+    static const int MAX_FUNCTIONS = 256;
+    
+    struct SegmentHeader {
+        DWORD magic;
+        DWORD size;
+        ULONGLONG index;
+    };
+    
+    // record = header + argument bytes, padded to 8
+    // magic is written last, so a record torn by a crash never looks complete
+    struct RecordHeader {
+        volatile DWORD magic;
+        DWORD length;
+        DWORD functionId;
+        DWORD checksum;       // header fields (not state) + argument bytes
+        volatile LONG state;  // RECORD_PENDING / RECORD_DONE
+        LONG priority;
+        ULONGLONG sequence;
+    };
+    
+    struct Segment {
+        ULONGLONG index;
+        HANDLE file;
+        HANDLE mapping;
+        BYTE* view;
+        DWORD size;
+        DWORD used;            // bytes written, segment header included
+        volatile LONG live;    // records not yet done
+        volatile LONG dirty;   // written (appends or done marks) since the last flush
+        volatile bool sealed;  // full - no more appends
+        Segment* volatile next;
+        
+        Segment() : index(0), file(INVALID_HANDLE_VALUE), mapping(NULL), view(nullptr), size(0), used(0),
+                    live(0), dirty(0), sealed(false), next(nullptr) {}
+    };
+    
+    // argument of the queued task
+    struct Job {
+        TaskJournal* journal;
+        Segment* segment;
+        RecordHeader* record;
+    };
+    
+    Scheduler* scheduler;
+    char directory[MAX_PATH];
+    DWORD segmentBytes;
+    DWORD flushIntervalMs;
+    JournalFunction functions[MAX_FUNCTIONS];
+    
+    // segments oldest first; appends go to tail (under cs), only flush passes unlink (under flushCs)
+    Segment* head;
+    Segment* tail;
+    bool opened;  // open() has started the first segment (under cs)
+    ULONGLONG nextSegment;
+    ULONGLONG nextSequence;
+    CRITICAL_SECTION cs;
+    
+    CRITICAL_SECTION flushCs;
+    CONDITION_VARIABLE flushCv;
+    HANDLE flushThread;
+    bool stopping;
+    
+    volatile LONG appended;
+    volatile LONG completed;
+    volatile LONG discarded;
+    volatile LONG replayed;
+    volatile LONG flushes;
+    
+    static DWORD align8(DWORD bytes) {
+        return (bytes + 7) & ~7u;
+    }
+    
+    // FNV-1a
+    static DWORD checksumOf(const RecordHeader* record, const void* data) {
+        DWORD h = 2166136261u;
+        const BYTE* fields[4] = { (const BYTE*)&record->length, (const BYTE*)&record->functionId,
+                                  (const BYTE*)&record->priority, (const BYTE*)&record->sequence };
+        const DWORD sizes[4] = { sizeof(record->length), sizeof(record->functionId), sizeof(record->priority),
+                                 sizeof(record->sequence) };
+        for (int f = 0; f < 4; f++) {
+            for (DWORD i = 0; i < sizes[f]; i++) {
+                h = (h ^ fields[f][i]) * 16777619u;
+            }
+        }
+        const BYTE* bytes = (const BYTE*)data;
+        for (DWORD i = 0; i < record->length; i++) {
+            h = (h ^ bytes[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    void segmentPath(char* path, size_t size, ULONGLONG index) const {
+        sprintf_s(path, size, "%s\\journal-%08llu.seg", directory, index);
+    }
+    
+    // map a segment file - create = new zero-filled file of segmentBytes, else open an existing one
+    Segment* mapSegment(ULONGLONG index, bool create) {
+        char path[MAX_PATH];
+        segmentPath(path, sizeof(path), index);
+        
+        HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, create ? CREATE_ALWAYS : OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        
+        DWORD size = segmentBytes;
+        if (!create) {
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(SegmentHeader) ||
+                fileSize.QuadPart > 0x7FFFFFFF) {
+                CloseHandle(file);
+                return nullptr;
+            }
+            size = (DWORD)fileSize.QuadPart;
+        }
+        
+        // mapping a new file at 'size' extends it with zeros
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, 0, size, NULL);
+        BYTE* view = mapping != NULL ? (BYTE*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+        if (view == nullptr) {
+            if (mapping != NULL) CloseHandle(mapping);
+            CloseHandle(file);
+            return nullptr;
+        }
+        
+        SegmentHeader* header = (SegmentHeader*)view;
+        if (create) {
+            header->size = size;
+            header->index = index;
+            header->magic = SEGMENT_MAGIC;
+        } else if (header->magic != SEGMENT_MAGIC || header->index != index) {
+            UnmapViewOfFile(view);
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return nullptr;
+        }
+        
+        Segment* segment = new Segment();
+        segment->index = index;
+        segment->file = file;
+        segment->mapping = mapping;
+        segment->view = view;
+        segment->size = size;
+        segment->used = sizeof(SegmentHeader);
+        return segment;
+    }
+    
+    void unmapSegment(Segment* segment, bool remove) {
+        UnmapViewOfFile(segment->view);
+        CloseHandle(segment->mapping);
+        CloseHandle(segment->file);
+        if (remove) {
+            char path[MAX_PATH];
+            segmentPath(path, sizeof(path), segment->index);
+            DeleteFileA(path);
+        }
+        delete segment;
+    }
+    
+    // cs held
+    void linkSegment(Segment* segment) {
+        if (tail == nullptr) {
+            head = tail = segment;
+        } else {
+            tail->next = segment;
+            tail = segment;
+        }
+    }
+    
+    // start the next segment (cs held) - the old tail is sealed
+    bool rotate() {
+        Segment* segment = mapSegment(nextSegment, true);
+        if (segment == nullptr) {
+            globalLogger.logf(LOG_ERROR, "Journal: cannot create segment %llu", nextSegment);
+            return false;
+        }
+        nextSegment++;
+        if (tail != nullptr) {
+            tail->sealed = true;
+        }
+        linkSegment(segment);
+        return true;
+    }
+    
+    // false if the scheduler refused it (the discard hook has marked it done)
+    bool queueRecord(Segment* segment, RecordHeader* record) {
+        Job* job = new Job();
+        job->journal = this;
+        job->segment = segment;
+        job->record = record;
+        
+        // the journal is a file - never index the scheduler's per-priority tables with what it says
+        int priority = (record->priority < 0 || record->priority >= PRIORITY_LEVELS) ? MEDIUM : record->priority;
+        Task task(RunJob, job, (TaskPriority)priority);
+        task.onDiscard = DiscardJob;
+        task.profileKey = (void*)functions[record->functionId];  // trace/profile by the journaled function
+        return scheduler->submitTask(task);
+    }
+    
+    // record ran or was discarded - it must not be replayed
+    void finish(Job* job) {
+        InterlockedExchange(&job->record->state, RECORD_DONE);
+        job->segment->dirty = 1;
+        InterlockedDecrement(&job->segment->live);
+        delete job;
+    }
+    
+    static void RunJob(void* arg) {
+        Job* job = (Job*)arg;
+        TaskJournal* journal = job->journal;
+        RecordHeader* record = job->record;
+        
+        journal->functions[record->functionId](record + 1, record->length);
+        
+        InterlockedIncrement(&journal->completed);
+        journal->finish(job);
+    }
+    
+    // refused, cancelled or shed - the scheduler decided it will not run, so it is not replayed either
+    static void DiscardJob(void* arg, FutureState) {
+        Job* job = (Job*)arg;
+        InterlockedIncrement(&job->journal->discarded);
+        job->journal->finish(job);
+    }
+    
+    // flush dirty segments and delete sealed ones that are fully done (flushCs held)
+    void flushPass() {
+        Segment* previous = nullptr;
+        Segment* segment = head;
+        while (segment != nullptr) {
+            Segment* next = segment->next;
+            
+            if (segment->sealed && segment->live == 0) {
+                EnterCriticalSection(&cs);
+                if (previous == nullptr) head = next;
+                else previous->next = next;
+                if (tail == segment) tail = previous;
+                LeaveCriticalSection(&cs);
+                
+                unmapSegment(segment, true);
+                segment = next;
+                continue;
+            }
+            
+            if (InterlockedExchange(&segment->dirty, 0) != 0) {
+                FlushViewOfFile(segment->view, 0);
+                FlushFileBuffers(segment->file);
+                InterlockedIncrement(&flushes);
+            }
+            
+            previous = segment;
+            segment = next;
+        }
+    }
+    
+    static DWORD WINAPI FlushThreadFunction(LPVOID param) {
+        TaskJournal* journal = (TaskJournal*)param;
+        
+        EnterCriticalSection(&journal->flushCs);
+        while (!journal->stopping) {
+            SleepConditionVariableCS(&journal->flushCv, &journal->flushCs, journal->flushIntervalMs);
+            journal->flushPass();
+        }
+        LeaveCriticalSection(&journal->flushCs);
+        return 0;
+    }
+    
+    // queue the pending records of one segment from an earlier run
+    void replaySegment(Segment* segment) {
+        segment->live = 1;  // guard - replayed tasks may finish before the scan does
+        
+        DWORD offset = sizeof(SegmentHeader);
+        while (offset + sizeof(RecordHeader) <= segment->size) {
+            RecordHeader* record = (RecordHeader*)(segment->view + offset);
+            if (record->magic != RECORD_MAGIC || record->length > segment->size - offset - sizeof(RecordHeader) ||
+                record->checksum != checksumOf(record, record + 1)) {
+                break;  // end of the written part, or a record torn by the crash
+            }
+            
+            if (record->sequence >= nextSequence) {
+                nextSequence = record->sequence + 1;
+            }
+            
+            if (record->state == RECORD_PENDING) {
+                if (record->functionId < MAX_FUNCTIONS && functions[record->functionId] != nullptr) {
+                    InterlockedIncrement(&segment->live);
+                    InterlockedIncrement(&replayed);
+                    queueRecord(segment, record);
+                } else {
+                    globalLogger.logf(LOG_WARNING, "Journal: no function registered for id %lu - record %llu dropped",
+                                      record->functionId, record->sequence);
+                    record->state = RECORD_DONE;
+                }
+            }
+            
+            offset += align8(sizeof(RecordHeader) + record->length);
+        }
+        
+        segment->used = offset;
+        segment->sealed = true;  // replayed segments are never appended to
+        segment->dirty = 1;
+        InterlockedDecrement(&segment->live);
+    }
+    
+    static void sortIndexes(ULONGLONG* indexes, int count) {
+        for (int i = 1; i < count; i++) {
+            ULONGLONG value = indexes[i];
+            int j = i - 1;
+            while (j >= 0 && indexes[j] > value) {
+                indexes[j + 1] = indexes[j];
+                j--;
+            }
+            indexes[j + 1] = value;
+        }
+    }
+    
+public:
+    // segmentBytes = size of each journal file; flushIntervalMs = how often appends are forced to disk
+    TaskJournal(Scheduler* s, const char* dir, DWORD segmentSize = 16 * 1024 * 1024, DWORD flushMs = 10)
+        : scheduler(s), segmentBytes(segmentSize), flushIntervalMs(flushMs), head(nullptr), tail(nullptr),
+          opened(false), nextSegment(0), nextSequence(0), flushThread(NULL), stopping(false),
+          appended(0), completed(0), discarded(0), replayed(0), flushes(0) {
+        sprintf_s(directory, "%s", dir);
+        for (int i = 0; i < MAX_FUNCTIONS; i++) {
+            functions[i] = nullptr;
+        }
+        InitializeCriticalSection(&cs);
+        InitializeCriticalSection(&flushCs);
+        InitializeConditionVariable(&flushCv);
+    }
+    
+    // journaled tasks must have finished (destroy after the scheduler)
+    // segments with pending records stay on disk for the next open()
+    ~TaskJournal() {
+        if (flushThread != NULL) {
+            EnterCriticalSection(&flushCs);
+            stopping = true;
+            WakeConditionVariable(&flushCv);
+            LeaveCriticalSection(&flushCs);
+            WaitForSingleObject(flushThread, INFINITE);
+            CloseHandle(flushThread);
+        }
+        
+        flushPass();
+        while (head != nullptr) {
+            Segment* next = head->next;
+            unmapSegment(head, head->live == 0);
+            head = next;
+        }
+        
+        DeleteCriticalSection(&cs);
+        DeleteCriticalSection(&flushCs);
+    }
+    
+    TaskJournal(const TaskJournal&) = delete;
+    TaskJournal& operator=(const TaskJournal&) = delete;
+    
+    // register every function before open() - ids are stored in the journal, keep them stable
+    bool registerFunction(DWORD id, JournalFunction function) {
+        if (id >= MAX_FUNCTIONS) return false;
+        functions[id] = function;
+        return true;
+    }
+    
+    // replay what an earlier run left pending, then start appending to a fresh segment
+    // returns the number of tasks replayed, -1 if the journal could not be opened
+    int open() {
+        CreateDirectoryA(directory, NULL);  // fails harmlessly if it exists
+        
+        char pattern[MAX_PATH];
+        sprintf_s(pattern, "%s\\journal-*.seg", directory);
+        
+        int count = 0;
+        int capacity = 16;
+        ULONGLONG* indexes = new ULONGLONG[capacity];
+        
+        WIN32_FIND_DATAA found;
+        HANDLE search = FindFirstFileA(pattern, &found);
+        if (search != INVALID_HANDLE_VALUE) {
+            do {
+                ULONGLONG index;
+                if (sscanf_s(found.cFileName, "journal-%llu.seg", &index) != 1) continue;
+                if (count == capacity) {
+                    ULONGLONG* grown = new ULONGLONG[capacity * 2];
+                    memcpy(grown, indexes, sizeof(ULONGLONG) * count);
+                    delete[] indexes;
+                    indexes = grown;
+                    capacity *= 2;
+                }
+                indexes[count++] = index;
+            } while (FindNextFileA(search, &found));
+            FindClose(search);
+        }
+        
+        // oldest first, so replayed tasks queue in their original order
+        sortIndexes(indexes, count);
+        
+        for (int i = 0; i < count; i++) {
+            if (indexes[i] >= nextSegment) {
+                nextSegment = indexes[i] + 1;
+            }
+            
+            Segment* segment = mapSegment(indexes[i], false);
+            if (segment == nullptr) {
+                globalLogger.logf(LOG_WARNING, "Journal: segment %llu is unreadable - skipped", indexes[i]);
+                continue;
+            }
+            
+            EnterCriticalSection(&cs);
+            linkSegment(segment);
+            LeaveCriticalSection(&cs);
+            replaySegment(segment);
+        }
+        delete[] indexes;
+        
+        EnterCriticalSection(&cs);
+        bool ok = rotate();
+        opened = ok;
+        LeaveCriticalSection(&cs);
+        if (!ok) {
+            return -1;
+        }
+        
+        flushThread = CreateThread(NULL, 0, FlushThreadFunction, this, 0, NULL);
+        
+        if (replayed > 0) {
+            globalLogger.logf(LOG_INFO, "Journal: replayed %ld pending tasks from %d segments", replayed, count);
+        }
+        return replayed;
+    }
+    
+    // append the task to the journal, then queue it - false if it was refused or is too large
+    // (a refused task is marked done: it is not replayed after a restart either)
+    bool enqueue(DWORD functionId, const void* data, DWORD length, TaskPriority priority = MEDIUM) {
+        if (functionId >= MAX_FUNCTIONS || functions[functionId] == nullptr) {
+            return false;
+        }
+        
+        DWORD recordBytes = align8(sizeof(RecordHeader) + length);
+        if (recordBytes > segmentBytes - sizeof(SegmentHeader)) {
+            return false;
+        }
+        
+        EnterCriticalSection(&cs);
+        
+        if (!opened) {
+            LeaveCriticalSection(&cs);
+            return false;  // open() has not run (or failed)
+        }
+        
+        if (tail->sealed || tail->used + recordBytes > tail->size) {
+            if (!rotate()) {
+                LeaveCriticalSection(&cs);
+                return false;
+            }
+        }
+        
+        Segment* segment = tail;
+        RecordHeader* record = (RecordHeader*)(segment->view + segment->used);
+        if (length > 0) {
+            memcpy(record + 1, data, length);
+        }
+        record->length = length;
+        record->functionId = functionId;
+        record->state = RECORD_PENDING;
+        record->priority = priority;
+        record->sequence = nextSequence++;
+        record->checksum = checksumOf(record, record + 1);
+        MemoryBarrier();
+        record->magic = RECORD_MAGIC;
+        
+        segment->used += recordBytes;
+        InterlockedIncrement(&segment->live);
+        segment->dirty = 1;
+        
+        LeaveCriticalSection(&cs);
+        
+        InterlockedIncrement(&appended);
+        
+        // outside the lock - submit may wait for space
+        return queueRecord(segment, record);
+    }
+    
+    // force everything appended so far to disk now (the flush thread does this every flushIntervalMs)
+    void flush() {
+        EnterCriticalSection(&flushCs);
+        flushPass();
+        LeaveCriticalSection(&flushCs);
+    }
+    
+    LONG getAppended() const {
+        return appended;
+    }
+    
+    LONG getCompleted() const {
+        return completed;
+    }
+    
+    LONG getDiscarded() const {
+        return discarded;
+    }
+    
+    // pending tasks from an earlier run queued by open()
+    LONG getReplayed() const {
+        return replayed;
+    }
+    
+    // flush passes that wrote at least one segment
+    LONG getFlushes() const {
+        return flushes;
+    }
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TASK_PRIORITY_H
+#define TASK_PRIORITY_H
+
+// task priority levels
+enum TaskPriority {
+    LOW = 0,
+    MEDIUM = 1,
+    HIGH = 2,
+    CRITICAL = 3
+};
+
+// number of priority levels (size of per-priority arrays)
+const int PRIORITY_LEVELS = 4;
+
+// printable name for a priority level
+inline const char* priorityName(int priority) {
+    switch (priority) {
+        case LOW:      return "LOW";
+        case MEDIUM:   return "MEDIUM";
+        case HIGH:     return "HIGH";
+        case CRITICAL: return "CRITICAL";
+        default:       return "UNKNOWN";
+    }
+}
+
+#endif
@@ -0,0 +1,233 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <windows.h>
+#include <intrin.h>
+#include <iostream>
+
+// per task type totals, as reported by TaskProfiler
+struct TaskTypeStats {
+    void* key;           // task function (or the function a wrapper runs)
+    const char* label;   // setLabel name, nullptr if none
+    LONGLONG calls;
+    double runMs;        // total time spent running
+    double avgRunUs;
+    double avgWaitMs;    // average queue wait before it started
+    double share;        // fraction of all profiled run time
+};
+
+// per task type CPU accounting - attach with scheduler.setProfiler(&profiler)
+// run time is measured with the cycle counter (__rdtsc) and added to the worker's own table,
+// so recording takes no lock; threads off the pool (caller-runs) share one locked table
+// run time is exclusive: tasks run nested inside another (helping while it waits on a future,
+// caller-runs submits from a task) count toward their own type only, so shares add up to 100%
+// of the time spent in task bodies
+class TaskProfiler {
+private:
+    struct Entry {
+        void* key;
+        LONGLONG calls;
+        ULONGLONG cycles;
+        LONGLONG waitTicks;  // QPC
+    };
+    
+    static const int TABLE_SIZE = 256;  // distinct task types per worker (power of 2)
+    static const int MAX_LABELS = 64;
+    
+    struct Table {
+        Entry entries[TABLE_SIZE];
+        Entry overflow;  // types beyond TABLE_SIZE
+    };
+    
+    Table* tables;
+    int workerTables;  // tables[workerTables] is the shared one
+    CRITICAL_SECTION sharedCs;
+    
+    // cycle counter calibration against QPC
+    LARGE_INTEGER frequency;
+    LONGLONG baseTicks;
+    ULONGLONG baseCycles;
+    
+    void* labelKeys[MAX_LABELS];
+    const char* labelNames[MAX_LABELS];
+    int labelCount;
+    
+    static void clearTable(Table& table) {
+        for (int i = 0; i < TABLE_SIZE; i++) {
+            table.entries[i].key = nullptr;
+            table.entries[i].calls = 0;
+            table.entries[i].cycles = 0;
+            table.entries[i].waitTicks = 0;
+        }
+        table.overflow.key = nullptr;
+        table.overflow.calls = 0;
+        table.overflow.cycles = 0;
+        table.overflow.waitTicks = 0;
+    }
+    
+    static void add(Table& table, void* key, ULONGLONG cycles, LONGLONG waitTicks) {
+        ULONG_PTR h = ((ULONG_PTR)key >> 4) * 0x9E3779B1u;
+        Entry* e = &table.overflow;
+        for (int probe = 0; probe < TABLE_SIZE; probe++) {
+            Entry* slot = &table.entries[(h + probe) & (TABLE_SIZE - 1)];
+            if (slot->key == key || slot->key == nullptr) {
+                slot->key = key;
+                e = slot;
+                break;
+            }
+        }
+        e->calls++;
+        e->cycles += cycles;
+        e->waitTicks += waitTicks;
+    }
+    
+    const char* labelOf(void* key) const {
+        for (int i = 0; i < labelCount; i++) {
+            if (labelKeys[i] == key) return labelNames[i];
+        }
+        return nullptr;
+    }
+    
+    double cyclesPerMs() const {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        ULONGLONG cycles = __rdtsc() - baseCycles;
+        double ms = (double)(now.QuadPart - baseTicks) * 1000.0 / frequency.QuadPart;
+        return ms > 0 ? (double)cycles / ms : 1.0;
+    }
+    
+public:
+    // maxWorkers = worker + spare threads that get a table of their own
+    TaskProfiler(int maxWorkers = 64) : workerTables(maxWorkers), labelCount(0) {
+        tables = new Table[workerTables + 1];
+        for (int i = 0; i <= workerTables; i++) {
+            clearTable(tables[i]);
+        }
+        InitializeCriticalSection(&sharedCs);
+        
+        QueryPerformanceFrequency(&frequency);
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        baseTicks = now.QuadPart;
+        baseCycles = __rdtsc();
+    }
+    
+    ~TaskProfiler() {
+        delete[] tables;
+        DeleteCriticalSection(&sharedCs);
+    }
+    
+    TaskProfiler(const TaskProfiler&) = delete;
+    TaskProfiler& operator=(const TaskProfiler&) = delete;
+    
+    // report 'name' instead of the function address - call before profiling
+    void setLabel(void* key, const char* name) {
+        if (labelCount < MAX_LABELS) {
+            labelKeys[labelCount] = key;
+            labelNames[labelCount] = name;
+            labelCount++;
+        }
+    }
+    
+    // worker = scheduler worker index, -1 (or out of range) = a thread off the pool
+    void record(int worker, void* key, ULONGLONG cycles, LONGLONG waitTicks) {
+        if (worker >= 0 && worker < workerTables) {
+            add(tables[worker], key, cycles, waitTicks);  // single writer
+        } else {
+            EnterCriticalSection(&sharedCs);
+            add(tables[workerTables], key, cycles, waitTicks);
+            LeaveCriticalSection(&sharedCs);
+        }
+    }
+    
+    // the n most expensive task types by total run time, most expensive first
+    // returns how many were written to 'out' (a snapshot - workers keep recording)
+    int getTop(TaskTypeStats* out, int n) const {
+        int capacity = (workerTables + 1) * (TABLE_SIZE + 1);
+        Entry* merged = new Entry[capacity];
+        int count = 0;
+        ULONGLONG totalCycles = 0;
+        
+        for (int t = 0; t <= workerTables; t++) {
+            for (int i = 0; i <= TABLE_SIZE; i++) {
+                const Entry& e = (i < TABLE_SIZE) ? tables[t].entries[i] : tables[t].overflow;
+                if (e.calls == 0) continue;
+                
+                int m = 0;
+                while (m < count && merged[m].key != e.key) {
+                    m++;
+                }
+                if (m == count) {
+                    merged[count].key = e.key;
+                    merged[count].calls = 0;
+                    merged[count].cycles = 0;
+                    merged[count].waitTicks = 0;
+                    count++;
+                }
+                merged[m].calls += e.calls;
+                merged[m].cycles += e.cycles;
+                merged[m].waitTicks += e.waitTicks;
+                totalCycles += e.cycles;
+            }
+        }
+        
+        double perMs = cyclesPerMs();
+        int written = 0;
+        while (written < n && written < count) {
+            // selection - n is small
+            int best = written;
+            for (int m = written + 1; m < count; m++) {
+                if (merged[m].cycles > merged[best].cycles) best = m;
+            }
+            Entry e = merged[best];
+            merged[best] = merged[written];
+            merged[written] = e;
+            
+            TaskTypeStats& s = out[written];
+            s.key = e.key;
+            s.label = labelOf(e.key);
+            s.calls = e.calls;
+            s.runMs = (double)e.cycles / perMs;
+            s.avgRunUs = s.runMs * 1000.0 / e.calls;
+            s.avgWaitMs = (double)e.waitTicks * 1000.0 / frequency.QuadPart / e.calls;
+            s.share = totalCycles > 0 ? (double)e.cycles / totalCycles : 0;
+            written++;
+        }
+        
+        delete[] merged;
+        return written;
+    }
+    
+    // print the top-n table (call next to Metrics::printStats)
+    void printTop(int n = 10) const {
+        TaskTypeStats* top = new TaskTypeStats[n];
+        int count = getTop(top, n);
+        
+        std::cout << "\n=== TOP " << n << " TASK TYPES (by run time) ===" << std::endl;
+        std::cout << "  Task                      Calls    Run ms   Avg us  Wait ms  Share" << std::endl;
+        for (int i = 0; i < count; i++) {
+            char name[32];
+            if (top[i].label != nullptr) {
+                sprintf_s(name, "%.24s", top[i].label);
+            } else {
+                sprintf_s(name, "%p", top[i].key);
+            }
+            
+            char line[160];
+            sprintf_s(line, "  %-24s %7lld %9.2f %8.2f %8.3f %5.1f%%", name, top[i].calls, top[i].runMs,
+                      top[i].avgRunUs, top[i].avgWaitMs, top[i].share * 100.0);
+            std::cout << line << std::endl;
+        }
+        
+        delete[] top;
+    }
+    
+    // start over (only while no tasks run)
+    void reset() {
+        for (int i = 0; i <= workerTables; i++) {
+            clearTable(tables[i]);
+        }
+    }
+};
+
+#endif
@@ -3,21 +3,44 @@
 
 #include <windows.h>
 #include "PriorityQueue.h"
+#include "ThreadSafeQueue.h"
+#include "DeadlineQueue.h"
+#include "FairQueue.h"
+#include "TenantQueue.h"
+#include "BlockingPool.h"
+#include "TaskTracer.h"
+#include "TaskProfiler.h"
+#include "WorkloadTrace.h"
+#include "IdleStrategy.h"
 #include "Metrics.h"
 #include "Logger.h"
 #include "Future.h"
-
-// task priority levels
-enum TaskPriority {
-    LOW = 0,
-    MEDIUM = 1,
-    HIGH = 2,
-    CRITICAL = 3
-};
+#include "TaskPriority.h"
 
 // function pointer type for tasks
 typedef void (*TaskFunction)(void*);
 
+// called with the task's argument when a queued task is dropped without running
+typedef void (*DiscardFunction)(void*, FutureState);
+
+struct Task;
+struct TaskTicket;
+
+// awaitable for hopping a coroutine onto a worker - defined in Coroutine.h
+template<typename Scheduler>
+class ScheduleAwaiter;
+
+// called when a task is shed for waiting too long in the queue
+typedef void (*ExpiryCallback)(const Task& task, double waitedMs);
+
+// what happens when a bounded queue is full
+enum OverflowPolicy {
+    OVERFLOW_BLOCK,           // producer waits for space (enqueueTask waits forever)
+    OVERFLOW_REJECT,          // refuse the new task
+    OVERFLOW_DROP_OLDEST_LOW, // drop the oldest queued LOW task to make room, else refuse
+    OVERFLOW_CALLER_RUNS      // run the new task on the producer's thread
+};
+
 // task structure - with cancellation support
 struct Task {
     TaskFunction function;
@@ -25,11 +48,37 @@ struct Task {
     TaskPriority priority;
     int taskId; // for debugging
     volatile bool* cancelFlag; // pointer to cancellation flag
+    LONGLONG enqueueTime; // QueryPerformanceCounter ticks, set on submit (for aging / wait metrics)
+    LONGLONG deadline; // absolute QPC ticks (see Deadline), 0 = none - EDF derives one from priority
+    int tenantId; // owning tenant, 0 = untagged
+    DiscardFunction onDiscard; // optional cleanup if the task never runs
+    LONGLONG maxWait; // per-task queue-wait limit in QPC ticks, 0 = use the per-priority limit, < 0 = none
+    TaskTicket* ticket; // shared by the queued copies of a boostable task, nullptr = not boostable
+    int rateTag; // rate-limit bucket (see setTagRateLimit), 0 = limited by priority only
+    bool rateAdmitted; // already passed its rate limit - released from the deferred list
+    void* profileKey; // task type for tracing/profiling when function is a wrapper, nullptr = function
+    bool admitted; // stands for work admitted earlier (submitAdmittedTask) - never evicted or shed
     
-    Task() : function(nullptr), argument(nullptr), priority(MEDIUM), taskId(-1), cancelFlag(nullptr) {}
+    Task() : function(nullptr), argument(nullptr), priority(MEDIUM), taskId(-1), cancelFlag(nullptr), 
+             enqueueTime(0), deadline(0), tenantId(0), onDiscard(nullptr), maxWait(0), ticket(nullptr),
+             rateTag(0), rateAdmitted(false), profileKey(nullptr), admitted(false) {}
     
     Task(TaskFunction func, void* arg, TaskPriority prio = MEDIUM, int id = -1, volatile bool* cancel = nullptr) 
-        : function(func), argument(arg), priority(prio), taskId(id), cancelFlag(cancel) {}
+        : function(func), argument(arg), priority(prio), taskId(id), cancelFlag(cancel), 
+          enqueueTime(0), deadline(0), tenantId(0), onDiscard(nullptr), maxWait(0), ticket(nullptr),
+          rateTag(0), rateAdmitted(false), profileKey(nullptr), admitted(false) {}
+    
+    // task type reported by the tracer and profiler
+    void* typeKey() const {
+        return profileKey != nullptr ? profileKey : (void*)function;
+    }
+    
+    // drop without running - lets wrappers (futures) release their state
+    void discard(FutureState reason) const {
+        if (onDiscard != nullptr) {
+            onDiscard(argument, reason);
+        }
+    }
     
     // check if task should be cancelled
     bool isCancelled() const {
@@ -42,9 +91,83 @@ struct Task {
     }
 };
 
-class TaskScheduler {
+// priority inheritance state of a queued task that produces a Future
+// a boost queues a copy at the higher level instead of moving the original (O(1) in the
+// bucket queues, O(log n) in the heap); the first up-to-date copy dequeued claims the task,
+// superseded copies are dropped when they surface
+struct TaskTicket {
+    Task task;               // copy to re-queue on a boost (task.ticket points here)
+    void* scheduler;         // owning BasicTaskScheduler
+    volatile LONG priority;  // level of the newest queued copy
+    volatile LONG claimed;   // 1 once a copy has run or been discarded
+    volatile LONG refs;      // queued copies + the future's boost hook
+    
+    TaskTicket(const Task& t, void* owner) : task(t), scheduler(owner), priority(t.priority), claimed(0), refs(2) {
+        task.ticket = this;
+    }
+    
+    // does this dequeued copy own the task? (drops the copy's reference either way)
+    bool claimCopy(const Task& copy) {
+        bool owns = copy.priority >= priority && InterlockedCompareExchange(&claimed, 1, 0) == 0;
+        release();
+        return owns;
+    }
+    
+    void release() {
+        if (InterlockedDecrement(&refs) == 0) {
+            delete this;
+        }
+    }
+};
+
+// future continuation - a completed future drops its boost hook's reference
+inline void ReleaseTaskTicket(void* context) {
+    ((TaskTicket*)context)->release();
+}
+
+// priority inheritance is pointless (harmful, even - a copy goes to the tail) for FIFO
+template<typename QueuePolicy>
+struct PriorityBoost {
+    static const bool enabled = true;
+};
+
+template<typename T>
+struct PriorityBoost< ThreadSafeQueue<T> > {
+    static const bool enabled = false;
+};
+
+// how the scheduler pushes into its queue - only TenantQueue can refuse a task (tenant caps)
+// requeue never refuses: it is for tasks that already held a place (boost copies, re-admits)
+template<typename QueuePolicy>
+struct QueueAdmission {
+    static bool enqueue(QueuePolicy& queue, const Task& task) {
+        queue.enqueue(task);
+        return true;
+    }
+    
+    static void requeue(QueuePolicy& queue, const Task& task) {
+        queue.enqueue(task);
+    }
+};
+
+template<typename T>
+struct QueueAdmission< TenantQueue<T> > {
+    static bool enqueue(TenantQueue<T>& queue, const Task& task) {
+        return queue.enqueue(task);
+    }
+    
+    static void requeue(TenantQueue<T>& queue, const Task& task) {
+        queue.enqueue(task, true);
+    }
+};
+
+// scheduler templated on its queue (scheduling policy) - chosen at compile time,
+// so enqueue/dequeue are direct inlinable calls with no virtual dispatch
+// a policy provides enqueue, dequeue, shutdown, size, setIdleStrategy and getSpinningWorkers
+template<typename QueuePolicy>
+class BasicTaskScheduler {
 private:
-    PriorityQueue<Task> taskQueue;
+    QueuePolicy taskQueue;
     HANDLE* workerThreads;
     int threadCount;
     bool isRunning;
@@ -63,39 +186,573 @@ private:
     int nextTaskId;  // auto-increment ID
     CRITICAL_SECTION cancelCs;
     
+    // keyed coalescing - one queued entry per key, later submissions merge into it
+    // an entry leaves the table when a worker starts it (or it is discarded)
+    struct KeyedEntry {
+        BasicTaskScheduler* scheduler;
+        ULONGLONG key;
+        TaskFunction function;
+        void* argument;
+        TaskTicket* ticket;  // re-queues the entry on a priority raise (nullptr for FIFO)
+        KeyedEntry* next;
+        
+        KeyedEntry(BasicTaskScheduler* s, ULONGLONG k, TaskFunction func, void* arg)
+            : scheduler(s), key(k), function(func), argument(arg), ticket(nullptr), next(nullptr) {}
+    };
+    
+    static const int KEYED_BUCKETS = 256;
+    KeyedEntry* keyedBuckets[KEYED_BUCKETS];
+    CRITICAL_SECTION keyedCs;
+    
+    // rate limiting - a token bucket per priority and per tag, checked when a worker picks a task
+    // a task without a token is parked on its bucket's deferred list (the worker moves on) and
+    // the limiter thread re-queues it once a token is due
+    struct DeferredTask {
+        Task task;
+        DeferredTask* next;
+        
+        DeferredTask(const Task& t) : task(t), next(nullptr) {}
+    };
+    
+    struct RateBucket {
+        double rate;          // tokens per second, 0 = unlimited
+        double burst;         // bucket size
+        double tokens;
+        LONGLONG lastRefill;  // QPC ticks
+        DeferredTask* deferredHead;
+        DeferredTask* deferredTail;
+    };
+    
+    static const int MAX_RATE_TAGS = 16;
+    RateBucket priorityBuckets[PRIORITY_LEVELS];
+    RateBucket tagBuckets[MAX_RATE_TAGS];
+    int rateTags[MAX_RATE_TAGS];
+    int rateTagCount;
+    bool rateLimited;  // any limit configured - workers skip the check otherwise
+    bool rateStopping;
+    HANDLE rateThread; // limiter, started by the first setRateLimit/setTagRateLimit
+    CRITICAL_SECTION rateCs;
+    CONDITION_VARIABLE rateCv;
+    
+    // bounded queue / backpressure - capacity 0 = unbounded
+    volatile LONG queuedTasks;  // tasks currently in taskQueue
+    LONG capacity;
+    OverflowPolicy overflowPolicy;
+    volatile LONG blockedProducers;
+    CRITICAL_SECTION capacityCs;
+    CONDITION_VARIABLE notFull;
+    
+    // load shedding - max queue wait per priority in QPC ticks (0 = never shed)
+    LONGLONG maxWaitTicks[PRIORITY_LEVELS];
+    ExpiryCallback expiryCallback;
+    LARGE_INTEGER frequency;
+    
+    // blocking tasks run here, never on the CPU workers
+    BlockingPool<Task> blockingPool;
+    
+    // blocking-region compensation - a spare worker is released for every worker
+    // blocked inside a blockingRegion(), so CPU parallelism stays at threadCount
+    static const int MAX_SPARE_WORKERS = 64;
+    HANDLE spareThreads[MAX_SPARE_WORKERS];
+    int spareThreadCount;
+    LONG blockedWorkers;   // workers currently inside a blocking region
+    LONG releasedSpares;   // spare workers currently allowed to run tasks
+    HANDLE spareSemaphore; // one count per released spare not yet running
+    CRITICAL_SECTION spareCs;
+    
+    // scheduler owning the current thread (nullptr off the pool) and its region nesting
+    static thread_local BasicTaskScheduler* currentScheduler;
+    static thread_local int blockingDepth;
+    
+    // worker index of the current thread - 0..threadCount-1, then spares (-1 off the pool)
+    static thread_local int workerIndex;
+    
+    // profiler cycles of the tasks run nested inside the current one on this thread (helping
+    // while it waits on a future, caller-runs submits) - taken off its own time
+    static thread_local ULONGLONG nestedCycles;
+    volatile LONG nextWorkerIndex;
+    
+    // time per state of every worker and spare, indexed by workerIndex
+    WorkerClock* workerClocks;
+    
+    // optional timeline recorder, per-type CPU accounting and workload capture, nullptr = off
+    TaskTracer* tracer;
+    TaskProfiler* profiler;
+    WorkloadTrace* recorder;
+    
+    void trace(TraceEventType type, const Task& task) {
+        if (tracer != nullptr) {
+            tracer->record(workerIndex, type, task.typeKey(), task.taskId, task.priority);
+        }
+    }
+    
+    // has this task waited longer than its own or its priority's limit?
+    bool isStale(const Task& task, LONGLONG waited) const {
+        LONGLONG limit = task.maxWait != 0 ? task.maxWait : maxWaitTicks[task.priority];
+        return limit > 0 && waited > limit;
+    }
+    
+    // charge a finished task body to the profiler - exclusive time, since the tasks nested in it
+    // were charged to their own types; the whole body then counts as nested in the enclosing task
+    void profileTask(TaskProfiler* accounting, const Task& task, ULONGLONG startCycles, ULONGLONG outerNested,
+                     LONGLONG waited) {
+        ULONGLONG elapsed = __rdtsc() - startCycles;
+        ULONGLONG inner = nestedCycles < elapsed ? nestedCycles : elapsed;
+        accounting->record(workerIndex, task.typeKey(), elapsed - inner, waited);
+        nestedCycles = outerNested + elapsed;
+    }
+    
+    // a worker took a task off the queue - free its slot, wake a blocked producer
+    void slotFreed(const Task& task) {
+        InterlockedDecrement(&queuedTasks);
+        metrics.taskUnqueued(task.priority);
+        
+        if (blockedProducers > 0) {
+            EnterCriticalSection(&capacityCs);
+            WakeConditionVariable(&notFull);
+            LeaveCriticalSection(&capacityCs);
+        }
+    }
+    
+    // run (or discard) a task just taken off the queue
+    void execute(Task& task) {
+        slotFreed(task);
+        
+        // superseded copy of a boosted task - the copy queued at the higher level runs instead
+        if (task.ticket != nullptr && !task.ticket->claimCopy(task)) {
+            taskQueue.taskFinished(task);
+            return;
+        }
+        
+        // over its rate limit - parked, and this worker moves on to the next task
+        if (rateLimited && !task.rateAdmitted && !task.isCancelled() && !admit(task)) {
+            taskQueue.taskFinished(task);
+            return;
+        }
+        
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        LONGLONG waited = now.QuadPart - task.enqueueTime;
+        metrics.recordQueueWait(task.priority, waited);
+        trace(TRACE_DEQUEUE, task);
+        
+        // check if task was cancelled before execution
+        if (task.isCancelled()) {
+            if (task.taskId >= 0) {  // group members carry no id - don't log each one
+                char msg[128];
+                sprintf_s(msg, "Task %d was CANCELLED before execution", task.taskId);
+                globalLogger.warning(msg);
+            }
+            trace(TRACE_CANCEL, task);
+            task.discard(FUTURE_CANCELLED);
+            metrics.taskDiscarded();
+            taskQueue.taskFinished(task);
+            return;
+        }
+        
+        // shed tasks nobody wants any more instead of deepening the backlog
+        if (isStale(task, waited)) {
+            if (expiryCallback != nullptr) {
+                expiryCallback(task, (double)waited * 1000.0 / frequency.QuadPart);
+            }
+            trace(TRACE_SHED, task);
+            task.discard(FUTURE_EXPIRED);
+            metrics.taskShed(task.priority);
+            taskQueue.taskFinished(task);
+            return;
+        }
+        
+        if (task.function != nullptr) {
+            // futures this task waits on inherit its priority
+            WaitHelper* helper = currentWaitHelper();
+            int outerPriority = helper->priority;
+            helper->priority = task.priority;
+            
+            trace(TRACE_START, task);
+            TaskProfiler* accounting = profiler;
+            ULONGLONG outerNested = nestedCycles;
+            nestedCycles = 0;
+            ULONGLONG startCycles = (accounting != nullptr) ? __rdtsc() : 0;
+            LARGE_INTEGER start;
+            start.QuadPart = 0;
+            if (recorder != nullptr) {
+                QueryPerformanceCounter(&start);
+            }
+            metrics.taskStarted();
+            {
+                WorkerStateScope state(WORKER_RUNNING);
+                task.function(task.argument);
+            }
+            metrics.taskCompleted();
+            if (accounting != nullptr) {
+                profileTask(accounting, task, startCycles, outerNested, waited);
+            } else {
+                nestedCycles = outerNested;
+            }
+            trace(TRACE_FINISH, task);
+            if (recorder != nullptr) {
+                LARGE_INTEGER end;
+                QueryPerformanceCounter(&end);
+                recorder->record(task.enqueueTime, start.QuadPart, end.QuadPart, task.priority, task.tenantId,
+                                 task.deadline);
+            }
+            
+            helper->priority = outerPriority;
+            
+            // SLA check for tasks submitted with an explicit deadline
+            if (task.deadline != 0) {
+                QueryPerformanceCounter(&now);
+                metrics.recordDeadline(now.QuadPart - task.deadline);
+            }
+            
+            if (task.tenantId != 0) {
+                metrics.tenantCompleted(task.tenantId, waited);
+            }
+        }
+        
+        taskQueue.taskFinished(task);
+    }
+    
+    // dequeue and run one task - false once the queue has shut down
+    bool runNextTask() {
+        Task task;
+        bool dequeued;
+        {
+            WorkerStateScope state(WORKER_QUEUE);
+            dequeued = taskQueue.dequeue(task);
+        }
+        if (!dequeued) {
+            return false;
+        }
+        execute(task);
+        return true;
+    }
+    
+    // run one queued task if there is one, without waiting
+    bool tryRunNextTask() {
+        Task task;
+        bool dequeued;
+        {
+            WorkerStateScope state(WORKER_QUEUE);
+            dequeued = taskQueue.tryDequeue(task);
+        }
+        if (!dequeued) {
+            return false;
+        }
+        execute(task);
+        return true;
+    }
+    
+    // WaitHelper hook - a worker blocked in Future::get() runs queued tasks meanwhile
+    static bool HelpRunTask(void* context) {
+        return ((BasicTaskScheduler*)context)->tryRunNextTask();
+    }
+    
     static DWORD WINAPI WorkerThreadFunction(LPVOID param) {
-        TaskScheduler* scheduler = (TaskScheduler*)param;
+        BasicTaskScheduler* scheduler = (BasicTaskScheduler*)param;
+        currentScheduler = scheduler;
+        workerIndex = InterlockedIncrement(&scheduler->nextWorkerIndex) - 1;
+        
+        WorkerClock* clock = &scheduler->workerClocks[workerIndex];
+        clock->start(WORKER_OVERHEAD);
+        currentWorkerClock() = clock;
+        
+        WaitHelper helper = { HelpRunTask, scheduler, -1 };
+        currentWaitHelper() = &helper;
+        
+        while (scheduler->runNextTask()) {}
+        
+        return 0;
+    }
+    
+    // parked until a worker enters a blocking region, then runs tasks until it is not needed
+    static DWORD WINAPI SpareThreadFunction(LPVOID param) {
+        BasicTaskScheduler* scheduler = (BasicTaskScheduler*)param;
+        currentScheduler = scheduler;
+        workerIndex = InterlockedIncrement(&scheduler->nextWorkerIndex) - 1;  // after the workers
+        
+        WorkerClock* clock = &scheduler->workerClocks[workerIndex];
+        clock->start(WORKER_OVERHEAD);
+        currentWorkerClock() = clock;
+        
+        WaitHelper helper = { HelpRunTask, scheduler, -1 };
+        currentWaitHelper() = &helper;
         
         while (true) {
-            Task task;
+            clock->enter(WORKER_PARKED);
+            WaitForSingleObject(scheduler->spareSemaphore, INFINITE);
+            clock->enter(WORKER_OVERHEAD);
+            if (!scheduler->isRunning) break;
             
-            if (!scheduler->taskQueue.dequeue(task)) {
-                break;
+            while (true) {
+                if (!scheduler->runNextTask()) {
+                    return 0;
+                }
+                
+                // retire once the blocked workers are back (checked between tasks)
+                EnterCriticalSection(&scheduler->spareCs);
+                bool retire = scheduler->releasedSpares > scheduler->blockedWorkers;
+                if (retire) {
+                    scheduler->releasedSpares--;
+                }
+                LeaveCriticalSection(&scheduler->spareCs);
+                
+                if (retire) break;
             }
+        }
+        
+        return 0;
+    }
+    
+    void enterBlockingRegion() {
+        EnterCriticalSection(&spareCs);
+        
+        blockedWorkers++;
+        if (releasedSpares < blockedWorkers && releasedSpares < MAX_SPARE_WORKERS) {
+            releasedSpares++;
             
-            // check if task was cancelled before execution
-            if (task.isCancelled()) {
-                char msg[128];
-                sprintf_s(msg, "Task %d was CANCELLED before execution", task.taskId);
-                globalLogger.warning(msg);
+            // every released spare needs a thread - start one if they are all taken
+            if (releasedSpares > spareThreadCount) {
+                spareThreads[spareThreadCount++] = CreateThread(NULL, 0, SpareThreadFunction, this, 0, NULL);
+            }
+            ReleaseSemaphore(spareSemaphore, 1, NULL);
+        }
+        
+        LeaveCriticalSection(&spareCs);
+    }
+    
+    void leaveBlockingRegion() {
+        EnterCriticalSection(&spareCs);
+        blockedWorkers--;
+        LeaveCriticalSection(&spareCs);
+    }
+    
+    KeyedEntry** keyedBucket(ULONGLONG key) {
+        return &keyedBuckets[(key * 0x9E3779B97F4A7C15ULL) >> 56];  // top 8 bits
+    }
+    
+    // take an entry out of the table - submissions for its key queue a new entry from here on
+    void unlinkKeyed(KeyedEntry* entry) {
+        EnterCriticalSection(&keyedCs);
+        KeyedEntry** link = keyedBucket(entry->key);
+        while (*link != entry) {
+            link = &(*link)->next;
+        }
+        *link = entry->next;
+        LeaveCriticalSection(&keyedCs);
+        
+        if (entry->ticket != nullptr) {
+            entry->ticket->release();  // the table's reference
+        }
+    }
+    
+    static void KeyedTask(void* arg) {
+        KeyedEntry* entry = (KeyedEntry*)arg;
+        entry->scheduler->unlinkKeyed(entry);
+        entry->function(entry->argument);
+        delete entry;
+    }
+    
+    static void KeyedDiscard(void* arg, FutureState) {
+        KeyedEntry* entry = (KeyedEntry*)arg;
+        entry->scheduler->unlinkKeyed(entry);
+        delete entry;
+    }
+    
+    static void initBucket(RateBucket& bucket) {
+        bucket.rate = 0;
+        bucket.burst = 0;
+        bucket.tokens = 0;
+        bucket.lastRefill = 0;
+        bucket.deferredHead = nullptr;
+        bucket.deferredTail = nullptr;
+    }
+    
+    // bucket limiting this task - its tag's if it has a configured one, else its priority's
+    RateBucket* rateBucketFor(const Task& task) {
+        if (task.rateTag != 0) {
+            for (int i = 0; i < rateTagCount; i++) {
+                if (rateTags[i] == task.rateTag) {
+                    return tagBuckets[i].rate > 0 ? &tagBuckets[i] : nullptr;
+                }
+            }
+        }
+        return priorityBuckets[task.priority].rate > 0 ? &priorityBuckets[task.priority] : nullptr;
+    }
+    
+    // rateCs held
+    void refill(RateBucket& bucket, LONGLONG now) {
+        bucket.tokens += (double)(now - bucket.lastRefill) * bucket.rate / frequency.QuadPart;
+        if (bucket.tokens > bucket.burst) {
+            bucket.tokens = bucket.burst;
+        }
+        bucket.lastRefill = now;
+    }
+    
+    // take a token for the task, or park it behind the bucket's deferred tasks (FIFO per bucket)
+    bool admit(Task& task) {
+        RateBucket* bucket = rateBucketFor(task);
+        if (bucket == nullptr) {
+            return true;
+        }
+        
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        
+        EnterCriticalSection(&rateCs);
+        refill(*bucket, now.QuadPart);
+        if (bucket->deferredHead == nullptr && bucket->tokens >= 1.0) {
+            bucket->tokens -= 1.0;
+            LeaveCriticalSection(&rateCs);
+            return true;
+        }
+        
+        // claimed already - the parked copy is the only one, so it no longer takes boosts
+        task.ticket = nullptr;
+        DeferredTask* node = new DeferredTask(task);
+        bool wasEmpty = (bucket->deferredHead == nullptr);
+        if (wasEmpty) {
+            bucket->deferredHead = bucket->deferredTail = node;
+        } else {
+            bucket->deferredTail->next = node;
+            bucket->deferredTail = node;
+        }
+        LeaveCriticalSection(&rateCs);
+        
+        if (wasEmpty) {
+            WakeConditionVariable(&rateCv);  // limiter recomputes its sleep
+        }
+        metrics.taskRateLimited();
+        return false;
+    }
+    
+    // rateCs held - move the tasks whose tokens are due to 'released', return ms until the next one
+    DWORD releaseDue(RateBucket& bucket, LONGLONG now, DeferredTask*& released) {
+        if (bucket.deferredHead == nullptr) {
+            return INFINITE;
+        }
+        
+        refill(bucket, now);
+        while (bucket.deferredHead != nullptr && (bucket.rate <= 0 || bucket.tokens >= 1.0)) {
+            DeferredTask* node = bucket.deferredHead;
+            bucket.deferredHead = node->next;
+            if (bucket.deferredHead == nullptr) {
+                bucket.deferredTail = nullptr;
+            }
+            if (bucket.rate > 0) {
+                bucket.tokens -= 1.0;
+            }
+            node->next = released;
+            released = node;
+        }
+        
+        if (bucket.deferredHead == nullptr) {
+            return INFINITE;
+        }
+        return (DWORD)((1.0 - bucket.tokens) * 1000.0 / bucket.rate) + 1;
+    }
+    
+    static DWORD WINAPI RateLimiterThreadFunction(LPVOID param) {
+        BasicTaskScheduler* scheduler = (BasicTaskScheduler*)param;
+        
+        EnterCriticalSection(&scheduler->rateCs);
+        while (!scheduler->rateStopping) {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            
+            DeferredTask* released = nullptr;
+            DWORD waitMs = INFINITE;
+            for (int i = 0; i < PRIORITY_LEVELS; i++) {
+                DWORD ms = scheduler->releaseDue(scheduler->priorityBuckets[i], now.QuadPart, released);
+                if (ms < waitMs) waitMs = ms;
+            }
+            for (int i = 0; i < scheduler->rateTagCount; i++) {
+                DWORD ms = scheduler->releaseDue(scheduler->tagBuckets[i], now.QuadPart, released);
+                if (ms < waitMs) waitMs = ms;
+            }
+            
+            if (released == nullptr) {
+                SleepConditionVariableCS(&scheduler->rateCv, &scheduler->rateCs, waitMs);
                 continue;
             }
             
-            if (task.function != nullptr) {
-                scheduler->metrics.taskStarted();
-                task.function(task.argument);
-                scheduler->metrics.taskCompleted();
+            LeaveCriticalSection(&scheduler->rateCs);
+            
+            // released list is newest first - restore bucket order
+            DeferredTask* ordered = nullptr;
+            while (released != nullptr) {
+                DeferredTask* next = released->next;
+                released->next = ordered;
+                ordered = released;
+                released = next;
+            }
+            
+            // holds its token already; bypasses capacity and tenant caps like a boost (it had a slot before)
+            while (ordered != nullptr) {
+                DeferredTask* next = ordered->next;
+                ordered->task.rateAdmitted = true;
+                InterlockedIncrement(&scheduler->queuedTasks);
+                scheduler->metrics.taskQueued(ordered->task.priority);
+                QueueAdmission<QueuePolicy>::requeue(scheduler->taskQueue, ordered->task);
+                delete ordered;
+                ordered = next;
             }
+            
+            EnterCriticalSection(&scheduler->rateCs);
         }
-        
+        LeaveCriticalSection(&scheduler->rateCs);
         return 0;
     }
     
+    void startRateLimiter() {
+        rateLimited = true;
+        if (rateThread == NULL) {
+            rateThread = CreateThread(NULL, 0, RateLimiterThreadFunction, this, 0, NULL);
+        }
+    }
+    
+    // tasks still parked at shutdown never run
+    void discardDeferred(RateBucket& bucket) {
+        while (bucket.deferredHead != nullptr) {
+            DeferredTask* node = bucket.deferredHead;
+            bucket.deferredHead = node->next;
+            node->task.discard(FUTURE_CANCELLED);
+            metrics.taskDiscarded();
+            delete node;
+        }
+        bucket.deferredTail = nullptr;
+    }
+    
 public:
-    TaskScheduler(int numThreads) : threadCount(numThreads), isRunning(true), 
-                                     cancellableTasksHead(nullptr), nextTaskId(0) {
+    BasicTaskScheduler(int numThreads, const IdleStrategy& idle = IdleStrategy()) 
+        : threadCount(numThreads), isRunning(true), cancellableTasksHead(nullptr), nextTaskId(0),
+          rateTagCount(0), rateLimited(false), rateStopping(false), rateThread(NULL),
+          queuedTasks(0), capacity(0), overflowPolicy(OVERFLOW_BLOCK), blockedProducers(0),
+          expiryCallback(nullptr), spareThreadCount(0), blockedWorkers(0), releasedSpares(0),
+          nextWorkerIndex(0), tracer(nullptr), profiler(nullptr), recorder(nullptr) {
         workerThreads = new HANDLE[threadCount];
+        workerClocks = new WorkerClock[threadCount + MAX_SPARE_WORKERS];
+        QueryPerformanceFrequency(&frequency);
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            maxWaitTicks[i] = 0;
+            initBucket(priorityBuckets[i]);
+        }
+        for (int i = 0; i < MAX_RATE_TAGS; i++) {
+            initBucket(tagBuckets[i]);
+            rateTags[i] = 0;
+        }
+        InitializeCriticalSection(&rateCs);
+        InitializeConditionVariable(&rateCv);
+        taskQueue.setIdleStrategy(idle);  // before any worker starts waiting
         InitializeCriticalSection(&cancelCs);
+        InitializeCriticalSection(&keyedCs);
+        for (int i = 0; i < KEYED_BUCKETS; i++) {
+            keyedBuckets[i] = nullptr;
+        }
+        InitializeCriticalSection(&capacityCs);
+        InitializeConditionVariable(&notFull);
+        InitializeCriticalSection(&spareCs);
+        spareSemaphore = CreateSemaphore(NULL, 0, 2 * MAX_SPARE_WORKERS, NULL);
         
         for (int i = 0; i < threadCount; i++) {
             workerThreads[i] = CreateThread(
@@ -104,7 +761,17 @@ public:
         }
     }
     
-    ~TaskScheduler() {
+    ~BasicTaskScheduler() {
+        // stop releasing parked tasks before the queue goes away
+        if (rateThread != NULL) {
+            EnterCriticalSection(&rateCs);
+            rateStopping = true;
+            WakeConditionVariable(&rateCv);
+            LeaveCriticalSection(&rateCs);
+            WaitForSingleObject(rateThread, INFINITE);
+            CloseHandle(rateThread);
+        }
+        
         taskQueue.shutdown();
         WaitForMultipleObjects(threadCount, workerThreads, TRUE, INFINITE);
         
@@ -113,6 +780,28 @@ public:
         }
         delete[] workerThreads;
         
+        // spares are either in dequeue (released by the queue shutdown) or parked on the semaphore
+        isRunning = false;
+        ReleaseSemaphore(spareSemaphore, spareThreadCount, NULL);
+        if (spareThreadCount > 0) {
+            WaitForMultipleObjects(spareThreadCount, spareThreads, TRUE, INFINITE);
+        }
+        for (int i = 0; i < spareThreadCount; i++) {
+            CloseHandle(spareThreads[i]);
+        }
+        CloseHandle(spareSemaphore);
+        DeleteCriticalSection(&spareCs);
+        
+        blockingPool.shutdown();
+        
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            discardDeferred(priorityBuckets[i]);
+        }
+        for (int i = 0; i < rateTagCount; i++) {
+            discardDeferred(tagBuckets[i]);
+        }
+        DeleteCriticalSection(&rateCs);
+        
         // cleanup cancellable tasks linked list
         EnterCriticalSection(&cancelCs);
         CancellableTask* current = cancellableTasksHead;
@@ -123,22 +812,320 @@ public:
         }
         LeaveCriticalSection(&cancelCs);
         DeleteCriticalSection(&cancelCs);
+        
+        // keyed entries still queued at shutdown never ran
+        for (int i = 0; i < KEYED_BUCKETS; i++) {
+            KeyedEntry* entry = keyedBuckets[i];
+            while (entry != nullptr) {
+                KeyedEntry* next = entry->next;
+                delete entry;
+                entry = next;
+            }
+        }
+        DeleteCriticalSection(&keyedCs);
+        DeleteCriticalSection(&capacityCs);
+        delete[] workerClocks;
+    }
+    
+private:
+    // may the caller run or discard this task? a keyed task can be raised between entering the
+    // key table and its submit - then the boosted copy owns it and this one only drops its reference
+    bool claimTask(const Task& task) {
+        return task.ticket == nullptr || task.ticket->claimCopy(task);
+    }
+    
+    // stamp and push a task - every enqueue path goes through here
+    // waitMs = how long to wait for space in a full queue before the overflow policy applies
+    // returns false if the task was refused (it has been discarded)
+    bool submit(Task& task, DWORD waitMs) {
+        bool blocked = false;
+        ULONGLONG waitStart = 0;
+        LARGE_INTEGER blockStart, now;
+        blockStart.QuadPart = 0;
+        
+        while (true) {
+            LONG queued = InterlockedIncrement(&queuedTasks);
+            if (capacity == 0 || queued <= capacity) {
+                break;
+            }
+            InterlockedDecrement(&queuedTasks);
+            
+            // full - wait for space while the caller's budget lasts
+            DWORD remaining = waitMs;
+            if (waitMs != INFINITE && blocked) {
+                ULONGLONG elapsed = GetTickCount64() - waitStart;
+                remaining = elapsed >= waitMs ? 0 : (DWORD)(waitMs - elapsed);
+            }
+            
+            if (remaining > 0) {
+                if (!blocked) {
+                    blocked = true;
+                    waitStart = GetTickCount64();
+                    QueryPerformanceCounter(&blockStart);
+                }
+                
+                EnterCriticalSection(&capacityCs);
+                InterlockedIncrement(&blockedProducers);
+                if (queuedTasks >= capacity) {
+                    SleepConditionVariableCS(&notFull, &capacityCs, remaining);
+                }
+                InterlockedDecrement(&blockedProducers);
+                LeaveCriticalSection(&capacityCs);
+                continue;
+            }
+            
+            if (blocked) {
+                QueryPerformanceCounter(&now);
+                metrics.producerBlocked(now.QuadPart - blockStart.QuadPart);
+                blocked = false;
+            }
+            
+            // still full - apply the overflow policy
+            if (overflowPolicy == OVERFLOW_DROP_OLDEST_LOW) {
+                Task victim;
+                if (taskQueue.evictOldest(LOW, victim)) {
+                    InterlockedDecrement(&queuedTasks);
+                    metrics.taskUnqueued(victim.priority);
+                    // a superseded boost copy only frees its slot
+                    if (claimTask(victim)) {
+                        victim.discard(FUTURE_REJECTED);
+                        metrics.taskDropped();
+                    }
+                    continue;
+                }
+            } else if (overflowPolicy == OVERFLOW_CALLER_RUNS) {
+                metrics.taskEnqueued();
+                if (!claimTask(task)) {
+                    return true;  // the boosted copy runs it
+                }
+                metrics.taskRanOnCaller();
+                TaskProfiler* accounting = profiler;
+                ULONGLONG outerNested = nestedCycles;
+                nestedCycles = 0;
+                ULONGLONG startCycles = (accounting != nullptr) ? __rdtsc() : 0;
+                metrics.taskStarted();
+                task.function(task.argument);
+                metrics.taskCompleted();
+                if (accounting != nullptr) {
+                    // off the pool this lands in the shared table; it never waited in the queue
+                    profileTask(accounting, task, startCycles, outerNested, 0);
+                } else {
+                    nestedCycles = outerNested;
+                }
+                return true;
+            }
+            
+            if (!claimTask(task)) {
+                metrics.taskEnqueued();  // the boosted copy carries it
+                return true;
+            }
+            metrics.taskRejected();
+            task.discard(FUTURE_REJECTED);
+            return false;
+        }
+        
+        if (blocked) {
+            QueryPerformanceCounter(&now);
+            metrics.producerBlocked(now.QuadPart - blockStart.QuadPart);
+        }
+        
+        QueryPerformanceCounter(&now);
+        task.enqueueTime = now.QuadPart;
+        if (task.ticket != nullptr) {
+            task.ticket->task.enqueueTime = task.enqueueTime;  // boosted copies keep the original wait
+        }
+        
+        trace(TRACE_ENQUEUE, task);  // before the push - a worker may start it at once
+        metrics.taskQueued(task.priority);
+        if (!QueueAdmission<QueuePolicy>::enqueue(taskQueue, task)) {
+            // its tenant is at its queued cap - give the slot back and drop it
+            slotFreed(task);
+            if (!claimTask(task)) {
+                metrics.taskEnqueued();  // the boosted copy carries it
+                return true;
+            }
+            trace(TRACE_REJECT, task);
+            metrics.taskRejected();
+            if (task.tenantId != 0) {
+                metrics.tenantRejected(task.tenantId);
+            }
+            task.discard(FUTURE_REJECTED);
+            return false;
+        }
+        metrics.taskEnqueued();
+        return true;
+    }
+    
+    // make a return task boostable: a higher-priority worker waiting on its future
+    // (get/wait/co_await) re-queues it at the waiter's level while it is still queued
+    template<typename T>
+    void attachTicket(Task& task, Future<T>* future) {
+        if (!PriorityBoost<QueuePolicy>::enabled) return;
+        
+        TaskTicket* ticket = new TaskTicket(task, this);
+        task.ticket = ticket;
+        future->onReady(ReleaseTaskTicket, ticket);  // before setBoost, so registering cannot boost
+        future->setBoost(BoostQueuedTask, ticket);
+    }
+    
+    // BoostFunction hook, called under the future's lock
+    static void BoostQueuedTask(void* context, int priority) {
+        TaskTicket* ticket = (TaskTicket*)context;
+        ((BasicTaskScheduler*)ticket->scheduler)->boost(ticket, priority);
+    }
+    
+    void boost(TaskTicket* ticket, int priority) {
+        if (priority >= PRIORITY_LEVELS) {
+            priority = PRIORITY_LEVELS - 1;
+        }
+        if (ticket->claimed || priority <= ticket->priority) {
+            return;  // already running, or queued high enough
+        }
+        
+        Task copy = ticket->task;
+        copy.priority = (TaskPriority)priority;
+        InterlockedIncrement(&ticket->refs);
+        ticket->priority = priority;  // older copies are superseded from here on
+        
+        // bypasses capacity and the overflow policy - a boost must never block or reject
+        InterlockedIncrement(&queuedTasks);
+        metrics.taskQueued(copy.priority);
+        QueueAdmission<QueuePolicy>::requeue(taskQueue, copy);
+        metrics.taskBoosted();
+    }
+    
+    // default wait for plain enqueueTask - only OVERFLOW_BLOCK waits
+    DWORD defaultWait() const {
+        return overflowPolicy == OVERFLOW_BLOCK ? INFINITE : 0;
     }
     
+public:
     // enqueue with default priority
     void enqueueTask(TaskFunction function, void* argument = nullptr) {
         Task task(function, argument, MEDIUM, -1, nullptr);
-        taskQueue.enqueue(task);
-        metrics.taskEnqueued();
+        submit(task, defaultWait());
     }
-
+    
     // enqueue with specific priority
     void enqueueTask(TaskFunction function, void* argument, TaskPriority priority, int taskId = -1) {
         Task task(function, argument, priority, taskId, nullptr);
-        taskQueue.enqueue(task);
+        submit(task, defaultWait());
+    }
+    
+    // non-blocking enqueue - false if the queue is full and the overflow policy refused it
+    bool tryEnqueueTask(TaskFunction function, void* argument, TaskPriority priority = MEDIUM) {
+        Task task(function, argument, priority, -1, nullptr);
+        return submit(task, 0);
+    }
+    
+    // wait up to timeoutMs for space, then apply the overflow policy
+    bool enqueueTaskFor(TaskFunction function, void* argument, TaskPriority priority, DWORD timeoutMs) {
+        Task task(function, argument, priority, -1, nullptr);
+        return submit(task, timeoutMs);
+    }
+    
+    // enqueue with an absolute deadline (EdfTaskScheduler orders by it; all policies track misses)
+    void enqueueTask(TaskFunction function, void* argument, Deadline deadline, TaskPriority priority = MEDIUM) {
+        Task task(function, argument, priority, -1, nullptr);
+        task.deadline = deadline.ticks;
+        submit(task, defaultWait());
+    }
+    
+    // run a task that blocks (sleeps, synchronous I/O, legacy libraries) on the elastic
+    // blocking pool instead of a CPU worker
+    void enqueueBlockingTask(TaskFunction function, void* argument = nullptr) {
+        Task task(function, argument, MEDIUM, -1, nullptr);
+        blockingPool.enqueue(task);
+    }
+    
+    // guard for a running task about to block - while it lives, a spare worker takes
+    // this worker's place (no-op off the pool; nested regions count once)
+    class BlockingRegion {
+    private:
+        BasicTaskScheduler* scheduler;
+        
+    public:
+        explicit BlockingRegion(BasicTaskScheduler* s) : scheduler(s) {
+            if (scheduler != nullptr && blockingDepth++ == 0) {
+                scheduler->enterBlockingRegion();
+            }
+        }
+        
+        BlockingRegion(BlockingRegion&& other) : scheduler(other.scheduler) {
+            other.scheduler = nullptr;
+        }
+        
+        BlockingRegion(const BlockingRegion&) = delete;
+        BlockingRegion& operator=(const BlockingRegion&) = delete;
+        
+        ~BlockingRegion() {
+            if (scheduler != nullptr && --blockingDepth == 0) {
+                scheduler->leaveBlockingRegion();
+            }
+        }
+    };
+    
+    BlockingRegion blockingRegion() {
+        return BlockingRegion(currentScheduler == this ? this : nullptr);
+    }
+    
+    // is the calling thread one of this scheduler's workers?
+    bool isWorkerThread() const {
+        return currentScheduler == this;
+    }
+    
+    BlockingPool<Task>& getBlockingPool() {
+        return blockingPool;
+    }
+    
+    // enqueue a prepared task (own discard hook, deadline, ...) - used by extensions such as IoReactor
+    // false if it was refused (it has been discarded)
+    bool submitTask(Task task) {
+        return submit(task, defaultWait());
+    }
+    
+    // enqueue past the capacity, overflow policy and tenant caps - never blocks or refuses
+    // for extension tasks that stand for work admitted earlier (a strand's drain, an I/O completion);
+    // once queued the task is neither evicted to make room nor shed for waiting too long
+    void submitAdmittedTask(Task task) {
+        task.admitted = true;
+        task.maxWait = -1;
+        
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        task.enqueueTime = now.QuadPart;
+        
+        InterlockedIncrement(&queuedTasks);
+        trace(TRACE_ENQUEUE, task);
+        metrics.taskQueued(task.priority);
+        QueueAdmission<QueuePolicy>::requeue(taskQueue, task);
         metrics.taskEnqueued();
     }
     
+    // enqueue for a tenant (TenantTaskScheduler) - false if the tenant is at its queued cap,
+    // or the queue is full and the overflow policy refuses it (capacity applies as to any task)
+    bool enqueueTenantTask(int tenantId, TaskFunction function, void* argument, TaskPriority priority = MEDIUM) {
+        Task task(function, argument, priority, -1, nullptr);
+        task.tenantId = tenantId;
+        if (!submit(task, defaultWait())) {
+            return false;
+        }
+        metrics.tenantEnqueued(tenantId);
+        return true;
+    }
+    
+    // tenant weight (share per round) and optional caps, 0 = unlimited (TenantTaskScheduler)
+    void configureTenant(int tenantId, int weight, int maxQueued = 0, int maxRunning = 0) {
+        taskQueue.configureTenant(tenantId, weight, maxQueued, maxRunning);
+    }
+    
+    // enqueue a task that is shed (never run) if it waits in the queue longer than maxWaitMs
+    void enqueueExpiringTask(TaskFunction function, void* argument, TaskPriority priority, DWORD maxWaitMs) {
+        Task task(function, argument, priority, -1, nullptr);
+        task.maxWait = (LONGLONG)maxWaitMs * frequency.QuadPart / 1000;
+        submit(task, defaultWait());
+    }
+    
     // enqueue CANCELLABLE task - returns task ID (NO LIMIT!)
     int enqueueCancellableTask(TaskFunction function, void* argument, TaskPriority priority = MEDIUM) {
         EnterCriticalSection(&cancelCs);
@@ -154,8 +1141,7 @@ public:
         LeaveCriticalSection(&cancelCs);
         
         Task task(function, argument, priority, taskId, &ct->cancelFlag);
-        taskQueue.enqueue(task);
-        metrics.taskEnqueued();
+        submit(task, defaultWait());
         
         char msg[128];
         sprintf_s(msg, "Cancellable task %d enqueued", taskId);
@@ -195,11 +1181,229 @@ public:
         return found;
     }
     
+    // enqueue a task for 'key' unless one for the same key is still queued - then the submission
+    // merges into it (that entry's function and argument run once) and, with raisePriority,
+    // lifts it to the higher of the two priorities
+    // returns true if a new entry was queued, false if merged (or refused)
+    bool enqueueKeyed(ULONGLONG key, TaskFunction function, void* argument = nullptr, TaskPriority priority = MEDIUM,
+                      bool raisePriority = true) {
+        EnterCriticalSection(&keyedCs);
+        
+        KeyedEntry** bucket = keyedBucket(key);
+        KeyedEntry* entry = *bucket;
+        while (entry != nullptr && entry->key != key) {
+            entry = entry->next;
+        }
+        
+        if (entry != nullptr) {
+            if (raisePriority && entry->ticket != nullptr) {
+                boost(entry->ticket, priority);  // no-op if already as high, or already started
+            }
+            LeaveCriticalSection(&keyedCs);
+            metrics.taskCoalesced();
+            return false;
+        }
+        
+        entry = new KeyedEntry(this, key, function, argument);
+        Task task(KeyedTask, entry, priority, -1, nullptr);
+        task.onDiscard = KeyedDiscard;
+        task.profileKey = (void*)function;
+        if (PriorityBoost<QueuePolicy>::enabled) {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            task.enqueueTime = now.QuadPart;  // a raise may copy the ticket before submit stamps it
+            entry->ticket = new TaskTicket(task, this);  // refs: the queued copy + the table
+            task.ticket = entry->ticket;
+        }
+        entry->next = *bucket;
+        *bucket = entry;
+        
+        LeaveCriticalSection(&keyedCs);
+        
+        // outside the lock - submit may wait for space
+        return submit(task, defaultWait());
+    }
+    
+    // bound the queue (0 = unbounded) and choose what happens when it is full
+    // set before producers start
+    void setCapacity(LONG maxQueued, OverflowPolicy policy = OVERFLOW_BLOCK) {
+        capacity = maxQueued;
+        overflowPolicy = policy;
+    }
+    
+    // load shedding - tasks of this priority waiting longer than maxWaitMs are discarded (0 = never)
+    // set before producers start
+    void setMaxQueueWait(TaskPriority priority, DWORD maxWaitMs) {
+        maxWaitTicks[priority] = (LONGLONG)maxWaitMs * frequency.QuadPart / 1000;
+    }
+    
+    // called on the worker for every shed task
+    void setExpiryCallback(ExpiryCallback callback) {
+        expiryCallback = callback;
+    }
+    
+    // token bucket for a priority level: at most perSecond tasks start per second, bursts of up to
+    // 'burst' (0 = perSecond disables the limit); over-limit tasks wait off-queue without a worker
+    void setRateLimit(TaskPriority priority, double perSecond, double burst = 1.0) {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        
+        EnterCriticalSection(&rateCs);
+        RateBucket& bucket = priorityBuckets[priority];
+        bucket.rate = perSecond;
+        bucket.burst = burst >= 1.0 ? burst : 1.0;
+        bucket.tokens = bucket.burst;
+        bucket.lastRefill = now.QuadPart;
+        startRateLimiter();
+        LeaveCriticalSection(&rateCs);
+        WakeConditionVariable(&rateCv);
+    }
+    
+    // token bucket shared by tasks enqueued with this tag (enqueueTaggedTask), overriding the
+    // priority limit for them - set before producers start; false if all tag slots are used
+    bool setTagRateLimit(int tag, double perSecond, double burst = 1.0) {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        
+        EnterCriticalSection(&rateCs);
+        int slot = 0;
+        while (slot < rateTagCount && rateTags[slot] != tag) {
+            slot++;
+        }
+        if (slot == MAX_RATE_TAGS) {
+            LeaveCriticalSection(&rateCs);
+            return false;
+        }
+        if (slot == rateTagCount) {
+            rateTags[slot] = tag;
+            rateTagCount++;
+        }
+        RateBucket& bucket = tagBuckets[slot];
+        bucket.rate = perSecond;
+        bucket.burst = burst >= 1.0 ? burst : 1.0;
+        bucket.tokens = bucket.burst;
+        bucket.lastRefill = now.QuadPart;
+        startRateLimiter();
+        LeaveCriticalSection(&rateCs);
+        WakeConditionVariable(&rateCv);
+        return true;
+    }
+    
+    // enqueue a task counted against the rate limit of 'tag' (tag must be nonzero)
+    void enqueueTaggedTask(int tag, TaskFunction function, void* argument, TaskPriority priority = MEDIUM) {
+        Task task(function, argument, priority, -1, nullptr);
+        task.rateTag = tag;
+        submit(task, defaultWait());
+    }
+    
+    // tasks parked over their rate limit
+    int getRateDeferred() {
+        int count = 0;
+        EnterCriticalSection(&rateCs);
+        for (int i = 0; i < PRIORITY_LEVELS; i++) {
+            for (DeferredTask* d = priorityBuckets[i].deferredHead; d != nullptr; d = d->next) count++;
+        }
+        for (int i = 0; i < rateTagCount; i++) {
+            for (DeferredTask* d = tagBuckets[i].deferredHead; d != nullptr; d = d->next) count++;
+        }
+        LeaveCriticalSection(&rateCs);
+        return count;
+    }
+    
+    // record scheduler events into 'recorder' (nullptr = stop) - set before producers start
+    void setTracer(TaskTracer* recorder) {
+        tracer = recorder;
+    }
+    
+    // attribute run time and queue wait per task type to 'accounting' (nullptr = stop)
+    // set before producers start
+    void setProfiler(TaskProfiler* accounting) {
+        profiler = accounting;
+    }
+    
+    // capture arrival, priority and run time of every finished task into 'trace' (nullptr = stop),
+    // to replay the workload in a SimScheduler - set before producers start
+    void setRecorder(WorkloadTrace* trace) {
+        recorder = trace;
+    }
+    
+    // index of the calling worker (0..threadCount-1, spares after), -1 off the pool
+    static int currentWorkerIndex() {
+        return workerIndex;
+    }
+    
+    // worker and spare threads started so far (valid indices for getWorkerUtilization)
+    int getWorkerCount() const {
+        return nextWorkerIndex;
+    }
+    
+    // time per state of one worker since it started (diff two snapshots for an interval)
+    WorkerUtilization getWorkerUtilization(int worker) const {
+        return WorkerUtilization::of(workerClocks[worker]);
+    }
+    
+    // summed over every worker and spare
+    WorkerUtilization getPoolUtilization() const {
+        WorkerUtilization pool;
+        for (int i = 0; i < nextWorkerIndex; i++) {
+            pool.add(WorkerUtilization::of(workerClocks[i]));
+        }
+        return pool;
+    }
+    
+    // per worker and pool-wide share of time running, idle (spinning/parked), in the queue and overhead
+    void printUtilization() const {
+        std::cout << "\n=== WORKER UTILIZATION ===" << std::endl;
+        std::cout << "  Worker   Running  Spinning  Parked  Queue  Overhead" << std::endl;
+        
+        char line[128];
+        int workers = nextWorkerIndex;
+        for (int i = 0; i <= workers; i++) {
+            WorkerUtilization u = (i < workers) ? getWorkerUtilization(i) : getPoolUtilization();
+            char name[16];
+            if (i < workers) {
+                sprintf_s(name, "%d%s", i, i >= threadCount ? "s" : "");
+            } else {
+                sprintf_s(name, "pool");
+            }
+            sprintf_s(line, "  %-6s %8.1f%% %8.1f%% %6.1f%% %5.1f%% %8.1f%%", name,
+                      u.percent(WORKER_RUNNING), u.percent(WORKER_SPINNING), u.percent(WORKER_PARKED),
+                      u.percent(WORKER_QUEUE), u.percent(WORKER_OVERHEAD));
+            std::cout << line << std::endl;
+        }
+    }
+    
+    // tasks currently queued (not yet picked up by a worker)
+    LONG getQueuedTasks() const {
+        return queuedTasks;
+    }
+    
     // get metrics
     Metrics& getMetrics() {
         return metrics;
     }
-
+    
+    // direct access to the policy for policy-specific settings
+    QueuePolicy& getQueue() {
+        return taskQueue;
+    }
+    
+    // priority aging (PriorityQueue policy only) - lets long-waiting LOW tasks overtake a sustained HIGH/CRITICAL load
+    void setAging(const AgingPolicy& policy) {
+        taskQueue.setAging(policy);
+    }
+    
+    // workers currently spinning for work (not parked)
+    LONG getSpinningWorkers() const {
+        return taskQueue.getSpinningWorkers();
+    }
+    
+    // co_await scheduler.schedule(priority) - resume the calling coroutine on a worker (include Coroutine.h)
+    // returns FUTURE_READY, or why the resume task was dropped
+    ScheduleAwaiter<BasicTaskScheduler> schedule(TaskPriority priority = MEDIUM) {
+        return ScheduleAwaiter<BasicTaskScheduler>(this, priority);
+    }
+    
     // enqueue task that returns a value
     template<typename T>
     Future<T>* enqueueTaskWithReturn(T (*function)(void*), void* argument, TaskPriority priority = MEDIUM) {
@@ -209,10 +1413,12 @@ public:
         // create wrapper task
         TaskWithReturn<T>* returnTask = new TaskWithReturn<T>(function, argument, future);
         
-        // enqueue wrapper
+        // enqueue wrapper - if it is refused, the future completes as FUTURE_REJECTED
         Task task((TaskFunction)ReturnTaskWrapper<T>, returnTask, priority, -1, nullptr);
-        taskQueue.enqueue(task);
-        metrics.taskEnqueued();
+        task.onDiscard = ReturnTaskDiscard<T>;
+        task.profileKey = (void*)function;
+        attachTicket(task, future);
+        submit(task, defaultWait());
         
         char msg[128];
         sprintf_s(msg, "Task with return value enqueued");
@@ -220,6 +1426,58 @@ public:
         
         return future;
     }
+    
+    // enqueue task that returns a value, with an absolute deadline
+    template<typename T>
+    Future<T>* enqueueTaskWithReturn(T (*function)(void*), void* argument, Deadline deadline, TaskPriority priority = MEDIUM) {
+        Future<T>* future = new Future<T>();
+        TaskWithReturn<T>* returnTask = new TaskWithReturn<T>(function, argument, future);
+        
+        Task task((TaskFunction)ReturnTaskWrapper<T>, returnTask, priority, -1, nullptr);
+        task.onDiscard = ReturnTaskDiscard<T>;
+        task.profileKey = (void*)function;
+        task.deadline = deadline.ticks;
+        attachTicket(task, future);
+        submit(task, defaultWait());
+        
+        return future;
+    }
+    
+    // enqueue task that returns a value, shed if it waits longer than maxWaitMs
+    // a shed task's future completes with FUTURE_EXPIRED
+    template<typename T>
+    Future<T>* enqueueExpiringTaskWithReturn(T (*function)(void*), void* argument, TaskPriority priority, DWORD maxWaitMs) {
+        Future<T>* future = new Future<T>();
+        TaskWithReturn<T>* returnTask = new TaskWithReturn<T>(function, argument, future);
+        
+        Task task((TaskFunction)ReturnTaskWrapper<T>, returnTask, priority, -1, nullptr);
+        task.onDiscard = ReturnTaskDiscard<T>;
+        task.profileKey = (void*)function;
+        task.maxWait = (LONGLONG)maxWaitMs * frequency.QuadPart / 1000;
+        attachTicket(task, future);
+        submit(task, defaultWait());
+        
+        return future;
+    }
 };
 
+template<typename QueuePolicy>
+thread_local BasicTaskScheduler<QueuePolicy>* BasicTaskScheduler<QueuePolicy>::currentScheduler = nullptr;
+
+template<typename QueuePolicy>
+thread_local int BasicTaskScheduler<QueuePolicy>::blockingDepth = 0;
+
+template<typename QueuePolicy>
+thread_local int BasicTaskScheduler<QueuePolicy>::workerIndex = -1;
+
+template<typename QueuePolicy>
+thread_local ULONGLONG BasicTaskScheduler<QueuePolicy>::nestedCycles = 0;
+
+// scheduling policies
+typedef BasicTaskScheduler< PriorityQueue<Task> >   TaskScheduler;      // strict priority (+ optional aging)
+typedef BasicTaskScheduler< ThreadSafeQueue<Task> > FifoTaskScheduler;  // plain FIFO, priority ignored
+typedef BasicTaskScheduler< DeadlineQueue<Task> >   EdfTaskScheduler;   // earliest deadline first
+typedef BasicTaskScheduler< FairQueue<Task> >       FairTaskScheduler;  // weighted fair share per priority
+typedef BasicTaskScheduler< TenantQueue<Task> >     TenantTaskScheduler; // weighted DRR across tenants
+
 #endif
\ No newline at end of file
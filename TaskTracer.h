@@ -0,0 +1,218 @@
+#ifndef TASK_TRACER_H
+#define TASK_TRACER_H
+
+#include <windows.h>
+#include <stdio.h>
+
+// scheduler events recorded by the tracer
+enum TraceEventType {
+    TRACE_ENQUEUE,   // submitted (producer thread)
+    TRACE_DEQUEUE,   // taken off the queue by a worker
+    TRACE_START,     // function about to run
+    TRACE_FINISH,    // function returned
+    TRACE_CANCEL,    // dropped - cancelled before it ran
+    TRACE_SHED,      // dropped - waited longer than its limit
+    TRACE_REJECT     // dropped - refused by the queue after it was counted (tenant cap)
+};
+
+struct TraceEvent {
+    LONGLONG timestamp;  // QPC ticks
+    void* function;
+    int taskId;
+    short priority;
+    short type;          // TraceEventType
+};
+
+// low-overhead timeline recorder - attach with scheduler.setTracer(&tracer)
+// each worker writes its own ring buffer (no locks, no sharing); threads off the pool
+// (producers) share one extra ring; when a ring is full the oldest events are overwritten
+// dump() writes Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev)
+class TaskTracer {
+private:
+    struct Ring {
+        TraceEvent* events;
+        volatile LONGLONG next;  // events ever written - slot = next % capacity
+    };
+    
+    static const int MAX_LABELS = 64;
+    
+    Ring* rings;
+    int workerRings;     // rings[workerRings] is the shared one
+    LONGLONG capacity;   // events per ring
+    volatile bool enabled;
+    LARGE_INTEGER frequency;
+    LONGLONG baseTicks;
+    
+    // readable names for task functions (set before tracing)
+    void* labelFunctions[MAX_LABELS];
+    const char* labelNames[MAX_LABELS];
+    int labelCount;
+    
+    const char* labelOf(void* function) const {
+        for (int i = 0; i < labelCount; i++) {
+            if (labelFunctions[i] == function) return labelNames[i];
+        }
+        return nullptr;
+    }
+    
+    static const char* typeName(int type) {
+        switch (type) {
+            case TRACE_ENQUEUE: return "enqueue";
+            case TRACE_DEQUEUE: return "dequeue";
+            case TRACE_CANCEL:  return "cancel";
+            case TRACE_SHED:    return "shed";
+            case TRACE_REJECT:  return "reject";
+            default:            return "task";
+        }
+    }
+    
+    static void write(HANDLE file, const char* text, int length) {
+        DWORD written;
+        WriteFile(file, text, (DWORD)length, &written, NULL);
+    }
+    
+public:
+    // maxWorkers = worker + spare threads that get a ring of their own
+    TaskTracer(int maxWorkers = 64, int eventsPerRing = 65536)
+        : workerRings(maxWorkers), capacity(eventsPerRing), enabled(true), labelCount(0) {
+        rings = new Ring[workerRings + 1];
+        for (int i = 0; i <= workerRings; i++) {
+            rings[i].events = new TraceEvent[eventsPerRing];
+            rings[i].next = 0;
+        }
+        QueryPerformanceFrequency(&frequency);
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        baseTicks = now.QuadPart;
+    }
+    
+    ~TaskTracer() {
+        for (int i = 0; i <= workerRings; i++) {
+            delete[] rings[i].events;
+        }
+        delete[] rings;
+    }
+    
+    TaskTracer(const TaskTracer&) = delete;
+    TaskTracer& operator=(const TaskTracer&) = delete;
+    
+    // pause/resume recording (the scheduler keeps calling record - it returns at once)
+    void setEnabled(bool on) {
+        enabled = on;
+    }
+    
+    bool isEnabled() const {
+        return enabled;
+    }
+    
+    // show 'name' instead of the function address in the viewer - call before tracing
+    void setLabel(void* function, const char* name) {
+        if (labelCount < MAX_LABELS) {
+            labelFunctions[labelCount] = function;
+            labelNames[labelCount] = name;
+            labelCount++;
+        }
+    }
+    
+    // worker = scheduler worker index, -1 (or out of range) = a thread off the pool
+    void record(int worker, TraceEventType type, void* function, int taskId, int priority) {
+        if (!enabled) return;
+        
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        
+        LONGLONG slot;
+        Ring* ring;
+        if (worker >= 0 && worker < workerRings) {
+            ring = &rings[worker];
+            slot = ring->next++;  // single writer
+        } else {
+            ring = &rings[workerRings];
+            slot = InterlockedIncrement64(&ring->next) - 1;
+        }
+        
+        TraceEvent& e = ring->events[slot % capacity];
+        e.timestamp = now.QuadPart;
+        e.function = function;
+        e.taskId = taskId;
+        e.priority = (short)priority;
+        e.type = (short)type;
+    }
+    
+    // events overwritten because a ring was full
+    LONGLONG getDropped() const {
+        LONGLONG dropped = 0;
+        for (int i = 0; i <= workerRings; i++) {
+            if (rings[i].next > capacity) dropped += rings[i].next - capacity;
+        }
+        return dropped;
+    }
+    
+    void clear() {
+        for (int i = 0; i <= workerRings; i++) {
+            rings[i].next = 0;
+        }
+    }
+    
+    // write everything recorded as Chrome trace-event JSON - pause (or stop the load) first
+    // workers are threads "worker N", producers share the thread "producers"
+    bool dump(const char* path) {
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        char line[256];
+        int n = sprintf_s(line, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        write(file, line, n);
+        
+        bool first = true;
+        for (int r = 0; r <= workerRings; r++) {
+            LONGLONG end = rings[r].next;
+            if (end == 0) continue;
+            LONGLONG begin = end > capacity ? end - capacity : 0;
+            
+            if (r < workerRings) {
+                n = sprintf_s(line, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}",
+                              first ? "" : ",\n", r, r);
+            } else {
+                n = sprintf_s(line, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"producers\"}}",
+                              first ? "" : ",\n", r);
+            }
+            write(file, line, n);
+            first = false;
+            
+            for (LONGLONG i = begin; i < end; i++) {
+                const TraceEvent& e = rings[r].events[i % capacity];
+                double us = (double)(e.timestamp - baseTicks) * 1000000.0 / frequency.QuadPart;
+                
+                char name[64];
+                const char* label = labelOf(e.function);
+                if (label != nullptr) {
+                    sprintf_s(name, "%.63s", label);  // longer labels are cut, not fatal
+                } else {
+                    sprintf_s(name, "task %p", e.function);
+                }
+                
+                const char* phase;
+                if (e.type == TRACE_START) phase = "B";
+                else if (e.type == TRACE_FINISH) phase = "E";
+                else phase = "i";
+                
+                n = sprintf_s(line, ",\n{\"name\":\"%s%s%s\",\"cat\":\"%s\",\"ph\":\"%s\",%s\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+                                    "\"args\":{\"id\":%d,\"priority\":%d}}",
+                              phase[0] == 'i' ? typeName(e.type) : "", phase[0] == 'i' ? " " : "", name,
+                              typeName(e.type), phase, phase[0] == 'i' ? "\"s\":\"t\"," : "", us, r,
+                              e.taskId, e.priority);
+                write(file, line, n);
+            }
+        }
+        
+        n = sprintf_s(line, "\n]}\n");
+        write(file, line, n);
+        CloseHandle(file);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,342 @@
+#ifndef TENANT_QUEUE_H
+#define TENANT_QUEUE_H
+
+#include <windows.h>
+#include "IdleStrategy.h"
+#include "TaskPriority.h"
+
+// multi-tenant fair-share queue - one sub-queue per tenant, served by weighted
+// deficit round robin, with optional per-tenant caps on queued and running tasks
+// within a tenant, items are served by priority (FIFO per level)
+// T needs 'priority', 'tenantId', 'enqueueTime' and 'admitted'
+template<typename T>
+class TenantQueue {
+private:
+    struct Node {
+        T data;
+        Node* next;
+        
+        Node(const T& value) : data(value), next(nullptr) {}
+    };
+    
+    struct Tenant {
+        int tenantId;
+        int weight;      // tasks served per round
+        int maxQueued;   // 0 = unlimited
+        int maxRunning;  // 0 = unlimited
+        int queued;
+        int running;
+        int deficit;     // tasks left in this tenant's current turn
+        Node* heads[PRIORITY_LEVELS];
+        Node* tails[PRIORITY_LEVELS];
+        Tenant* next;    // circular ring of all tenants
+        
+        Tenant(int id) : tenantId(id), weight(1), maxQueued(0), maxRunning(0),
+                         queued(0), running(0), deficit(0), next(nullptr) {
+            for (int i = 0; i < PRIORITY_LEVELS; i++) {
+                heads[i] = nullptr;
+                tails[i] = nullptr;
+            }
+        }
+        
+        bool eligible() const {
+            return queued > 0 && (maxRunning == 0 || running < maxRunning);
+        }
+    };
+    
+    Tenant* cursor;  // DRR position in the ring (nullptr = no tenants yet)
+    int tenantCount;
+    volatile LONG count;  // read lock-free by spinning workers
+    
+    CRITICAL_SECTION cs;
+    CONDITION_VARIABLE notEmpty;
+    volatile bool isShutdown;
+    IdleState idle;
+    
+    // find or create a tenant (under cs)
+    Tenant* getTenant(int tenantId) {
+        if (cursor != nullptr) {
+            Tenant* t = cursor;
+            do {
+                if (t->tenantId == tenantId) return t;
+                t = t->next;
+            } while (t != cursor);
+        }
+        
+        Tenant* t = new Tenant(tenantId);
+        if (cursor == nullptr) {
+            t->next = t;
+            cursor = t;
+        } else {
+            // insert behind the cursor so the newcomer waits a full round
+            t->next = cursor->next;
+            cursor->next = t;
+        }
+        tenantCount++;
+        return t;
+    }
+    
+    // deficit round robin with unit cost per task (under cs)
+    // returns nullptr if every tenant with work is held back by its running cap
+    Tenant* pickTenant() {
+        for (int scanned = 0; scanned <= tenantCount; scanned++) {
+            Tenant* t = cursor;
+            
+            if (t->eligible()) {
+                if (t->deficit <= 0) {
+                    t->deficit = t->weight;
+                }
+                return t;
+            }
+            
+            // an idle or capped tenant forfeits the rest of its turn
+            t->deficit = 0;
+            cursor = cursor->next;
+        }
+        return nullptr;
+    }
+    
+    void popFrom(Tenant* t, T& outValue) {
+        for (int level = PRIORITY_LEVELS - 1; level >= 0; level--) {
+            Node* node = t->heads[level];
+            if (node == nullptr) continue;
+            
+            t->heads[level] = node->next;
+            if (t->heads[level] == nullptr) {
+                t->tails[level] = nullptr;
+            }
+            outValue = node->data;
+            delete node;
+            break;
+        }
+        
+        t->queued--;
+        t->running++;
+        t->deficit--;
+        
+        // turn is over - move on to the next tenant
+        if (t->deficit <= 0 || !t->eligible()) {
+            t->deficit = 0;
+            cursor = t->next;
+        }
+    }
+    
+public:
+    TenantQueue() : cursor(nullptr), tenantCount(0), count(0), isShutdown(false) {
+        InitializeCriticalSection(&cs);
+        InitializeConditionVariable(&notEmpty);
+    }
+    
+    ~TenantQueue() {
+        EnterCriticalSection(&cs);
+        
+        for (int i = 0; i < tenantCount; i++) {
+            Tenant* t = cursor;
+            cursor = cursor->next;
+            
+            for (int level = 0; level < PRIORITY_LEVELS; level++) {
+                while (t->heads[level] != nullptr) {
+                    Node* temp = t->heads[level];
+                    t->heads[level] = temp->next;
+                    delete temp;
+                }
+            }
+            delete t;
+        }
+        
+        LeaveCriticalSection(&cs);
+        DeleteCriticalSection(&cs);
+    }
+    
+    // returns false (and queues nothing) if the tenant is at its queued cap
+    // overCap = queue past the cap - for an item that already held a place (boost copy, re-admit)
+    bool enqueue(const T& value, bool overCap = false) {
+        Node* newNode = new Node(value);
+        int level = (value.priority < 0 || value.priority >= PRIORITY_LEVELS) ? MEDIUM : value.priority;
+        
+        EnterCriticalSection(&cs);
+        
+        Tenant* t = getTenant(value.tenantId);
+        if (!overCap && t->maxQueued > 0 && t->queued >= t->maxQueued) {
+            LeaveCriticalSection(&cs);
+            delete newNode;
+            return false;
+        }
+        
+        if (t->tails[level] == nullptr) {
+            t->heads[level] = t->tails[level] = newNode;
+        } else {
+            t->tails[level]->next = newNode;
+            t->tails[level] = newNode;
+        }
+        t->queued++;
+        count++;
+        
+        LeaveCriticalSection(&cs);
+        
+        if (idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+    
+    bool dequeue(T& outValue) {
+        if (count == 0 && !isShutdown) {
+            idle.spinForWork(&count, &isShutdown);
+        }
+        
+        EnterCriticalSection(&cs);
+        
+        Tenant* t = nullptr;
+        while (true) {
+            if (count > 0) {
+                t = pickTenant();
+                if (t != nullptr) break;
+            } else if (isShutdown) {
+                LeaveCriticalSection(&cs);
+                return false;
+            }
+            
+            // empty, or everything queued is held back by running caps
+            idle.parking();
+            SleepConditionVariableCS(&notEmpty, &cs, INFINITE);
+            idle.unparked();
+        }
+        
+        popFrom(t, outValue);
+        count--;
+        LONG remaining = count;
+        
+        LeaveCriticalSection(&cs);
+        
+        if (remaining > 0 && idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+    
+    // non-blocking dequeue - false if nothing is queued or every tenant is at its running cap
+    bool tryDequeue(T& outValue) {
+        if (count == 0) return false;
+        
+        EnterCriticalSection(&cs);
+        
+        Tenant* t = count > 0 ? pickTenant() : nullptr;
+        if (t == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        popFrom(t, outValue);
+        count--;
+        
+        LeaveCriticalSection(&cs);
+        return true;
+    }
+    
+    // remove the oldest queued item of one priority level across all tenants (overflow drop policy)
+    // admitted items are never evicted - they are stepped over
+    bool evictOldest(int priority, T& outValue) {
+        if (priority < 0 || priority >= PRIORITY_LEVELS) return false;
+        
+        EnterCriticalSection(&cs);
+        
+        Tenant* victim = nullptr;
+        Node* temp = nullptr;
+        Node* prev = nullptr;
+        for (int i = 0; i < tenantCount; i++) {
+            Tenant* t = cursor;
+            cursor = cursor->next;  // full lap - cursor ends where it started
+            
+            Node* before = nullptr;
+            Node* node = t->heads[priority];
+            while (node != nullptr && node->data.admitted) {
+                before = node;
+                node = node->next;
+            }
+            if (node != nullptr && (temp == nullptr || node->data.enqueueTime < temp->data.enqueueTime)) {
+                victim = t;
+                temp = node;
+                prev = before;
+            }
+        }
+        
+        if (victim == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+        
+        if (prev == nullptr) {
+            victim->heads[priority] = temp->next;
+        } else {
+            prev->next = temp->next;
+        }
+        if (victim->tails[priority] == temp) {
+            victim->tails[priority] = prev;
+        }
+        victim->queued--;
+        count--;
+        outValue = temp->data;
+        
+        LeaveCriticalSection(&cs);
+        
+        delete temp;
+        return true;
+    }
+    
+    // policy hook - a dequeued task finished (or was skipped); frees a running slot
+    void taskFinished(const T& value) {
+        EnterCriticalSection(&cs);
+        Tenant* t = getTenant(value.tenantId);
+        bool unblocked = (t->maxRunning > 0 && t->running == t->maxRunning && t->queued > 0);
+        t->running--;
+        LeaveCriticalSection(&cs);
+        
+        // a worker may be parked because this tenant was at its cap
+        if (unblocked) {
+            WakeConditionVariable(&notEmpty);
+        }
+    }
+    
+    // weight = tasks per round relative to other tenants; caps of 0 mean unlimited
+    void configureTenant(int tenantId, int weight, int maxQueued = 0, int maxRunning = 0) {
+        EnterCriticalSection(&cs);
+        Tenant* t = getTenant(tenantId);
+        t->weight = weight > 0 ? weight : 1;
+        t->maxQueued = maxQueued;
+        t->maxRunning = maxRunning;
+        LeaveCriticalSection(&cs);
+        
+        // a raised running cap may unblock parked workers
+        WakeAllConditionVariable(&notEmpty);
+    }
+    
+    int tenantQueued(int tenantId) {
+        EnterCriticalSection(&cs);
+        int n = getTenant(tenantId)->queued;
+        LeaveCriticalSection(&cs);
+        return n;
+    }
+    
+    void shutdown() {
+        EnterCriticalSection(&cs);
+        isShutdown = true;
+        WakeAllConditionVariable(&notEmpty);
+        LeaveCriticalSection(&cs);
+    }
+    
+    void setIdleStrategy(const IdleStrategy& strategy) {
+        idle.setStrategy(strategy);
+    }
+    
+    LONG getSpinningWorkers() const {
+        return idle.getSpinningWorkers();
+    }
+    
+    // lock-free snapshot - count is an aligned volatile LONG, so the read is atomic
+    int size() const {
+        return count;
+    }
+};
+
+#endif
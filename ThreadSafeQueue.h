@@ -2,6 +2,7 @@
 #define THREADSAFE_QUEUE_H
 
 #include <windows.h>
+#include "IdleStrategy.h"
 
 template<typename T>
 class ThreadSafeQueue {
@@ -15,12 +16,13 @@ private:
 
     Node* head;
     Node* tail;
-    int count;
+    volatile LONG count;  // read lock-free by spinning workers
 
     // WinAPI synchronization primitives
 	CRITICAL_SECTION cs;           // mutex for protecting access
 	CONDITION_VARIABLE notEmpty;   // signal for not empty queue
-	bool isShutdown;               // flag for shutdown
+	volatile bool isShutdown;      // flag for shutdown
+	IdleState idle;                // spin-then-park bookkeeping
 
 public:
     ThreadSafeQueue() : head(nullptr), tail(nullptr), count(0), isShutdown(false) {
@@ -57,19 +59,28 @@ public:
         }
         count++;
 
-		// notify one waiting thread
-        WakeConditionVariable(&notEmpty);
-
         LeaveCriticalSection(&cs);
+
+		// notify one waiting thread - outside the lock, skipped if someone is spinning
+        if (idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
     }
 
 	// remove element
     bool dequeue(T& outValue) {
+		// spin/yield before parking
+        if (count == 0 && !isShutdown) {
+            idle.spinForWork(&count, &isShutdown);
+        }
+
         EnterCriticalSection(&cs);
 
 		// wait until not empty or shutdown
         while (head == nullptr && !isShutdown) {
+            idle.parking();
             SleepConditionVariableCS(&notEmpty, &cs, INFINITE);
+            idle.unparked();
         }
 
 		// if shutdown and empty, return false
@@ -87,6 +98,38 @@ public:
             tail = nullptr;
         }
 
+        delete temp;
+        count--;
+        LONG remaining = count;
+
+        LeaveCriticalSection(&cs);
+
+		// pass the baton if work is left and nobody is looking for it
+        if (remaining > 0 && idle.shouldWake()) {
+            WakeConditionVariable(&notEmpty);
+        }
+        return true;
+    }
+
+	// remove element without waiting - false if empty (waiters helping out use this)
+    bool tryDequeue(T& outValue) {
+        if (count == 0) return false;
+
+        EnterCriticalSection(&cs);
+
+        if (head == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+
+        Node* temp = head;
+        outValue = head->data;
+        head = head->next;
+
+        if (head == nullptr) {
+            tail = nullptr;
+        }
+
         delete temp;
         count--;
 
@@ -101,11 +144,56 @@ public:
         return empty;
     }
 
-    int size() {
+    // lock-free snapshot - count is an aligned volatile LONG, so the read is atomic
+    int size() const {
+        return count;
+    }
+
+	// remove the oldest item with a given priority (overflow drop policy) - O(n) scan
+	// admitted items are never evicted
+    bool evictOldest(int priority, T& outValue) {
         EnterCriticalSection(&cs);
-        int sz = count;
+
+        Node* prev = nullptr;
+        Node* current = head;
+        while (current != nullptr && (current->data.priority != priority || current->data.admitted)) {
+            prev = current;
+            current = current->next;
+        }
+
+        if (current == nullptr) {
+            LeaveCriticalSection(&cs);
+            return false;
+        }
+
+		// unlink
+        if (prev == nullptr) {
+            head = current->next;
+        }
+        else {
+            prev->next = current->next;
+        }
+        if (tail == current) {
+            tail = prev;
+        }
+
+        outValue = current->data;
+        delete current;
+        count--;
+
         LeaveCriticalSection(&cs);
-        return sz;
+        return true;
+    }
+
+    // policy hook - called when a dequeued task is done (nothing to track here)
+    void taskFinished(const T&) {}
+
+    void setIdleStrategy(const IdleStrategy& strategy) {
+        idle.setStrategy(strategy);
+    }
+
+    LONG getSpinningWorkers() const {
+        return idle.getSpinningWorkers();
     }
 
 	// for shutdown
@@ -0,0 +1,123 @@
+#ifndef WORKER_STATE_H
+#define WORKER_STATE_H
+
+#include <windows.h>
+#include <intrin.h>
+
+// what a worker thread is doing
+enum WorkerState {
+    WORKER_RUNNING,   // inside a task function
+    WORKER_SPINNING,  // idle, spinning/yielding for work
+    WORKER_PARKED,    // idle, asleep on the queue (or a spare waiting to be released)
+    WORKER_QUEUE,     // in dequeue otherwise - acquiring the queue lock and taking a task
+    WORKER_OVERHEAD,  // scheduler bookkeeping between tasks
+    WORKER_STATES
+};
+
+// time per state for one worker - written only by its own thread, so a state change is two
+// cycle-counter reads apart and takes no lock or interlocked operation
+struct WorkerClock {
+    volatile LONG state;
+    volatile ULONGLONG since;                   // __rdtsc() at the last change
+    volatile ULONGLONG cycles[WORKER_STATES];   // closed intervals per state
+    
+    WorkerClock() : state(WORKER_OVERHEAD), since(0) {
+        for (int i = 0; i < WORKER_STATES; i++) {
+            cycles[i] = 0;
+        }
+    }
+    
+    void start(WorkerState initial) {
+        state = initial;
+        since = __rdtsc();
+    }
+    
+    // switch state, returns the previous one (so nested sections can restore it)
+    WorkerState enter(WorkerState next) {
+        ULONGLONG now = __rdtsc();
+        WorkerState previous = (WorkerState)state;
+        cycles[previous] += now - since;
+        since = now;
+        state = next;
+        return previous;
+    }
+};
+
+// clock of the worker running on this thread, nullptr off the pool
+inline WorkerClock*& currentWorkerClock() {
+    static thread_local WorkerClock* clock = nullptr;
+    return clock;
+}
+
+// scoped state change for the current worker (no-op off the pool) - restores the outer state
+struct WorkerStateScope {
+    WorkerClock* clock;
+    WorkerState previous;
+    
+    WorkerStateScope(WorkerState state) : clock(currentWorkerClock()), previous(WORKER_OVERHEAD) {
+        if (clock != nullptr) {
+            previous = clock->enter(state);
+        }
+    }
+    
+    ~WorkerStateScope() {
+        if (clock != nullptr) {
+            clock->enter(previous);
+        }
+    }
+};
+
+// snapshot of time per state - per worker or summed over the pool
+struct WorkerUtilization {
+    ULONGLONG cycles[WORKER_STATES];
+    
+    WorkerUtilization() {
+        for (int i = 0; i < WORKER_STATES; i++) {
+            cycles[i] = 0;
+        }
+    }
+    
+    // read another thread's clock - the open interval counts toward its current state
+    static WorkerUtilization of(const WorkerClock& clock) {
+        WorkerUtilization u;
+        for (int i = 0; i < WORKER_STATES; i++) {
+            u.cycles[i] = clock.cycles[i];
+        }
+        ULONGLONG since = clock.since;
+        ULONGLONG now = __rdtsc();
+        if (since != 0 && now > since) {
+            u.cycles[clock.state] += now - since;
+        }
+        return u;
+    }
+    
+    void add(const WorkerUtilization& other) {
+        for (int i = 0; i < WORKER_STATES; i++) {
+            cycles[i] += other.cycles[i];
+        }
+    }
+    
+    // the interval since an earlier snapshot of the same worker(s)
+    WorkerUtilization since(const WorkerUtilization& earlier) const {
+        WorkerUtilization d;
+        for (int i = 0; i < WORKER_STATES; i++) {
+            d.cycles[i] = cycles[i] > earlier.cycles[i] ? cycles[i] - earlier.cycles[i] : 0;
+        }
+        return d;
+    }
+    
+    ULONGLONG total() const {
+        ULONGLONG sum = 0;
+        for (int i = 0; i < WORKER_STATES; i++) {
+            sum += cycles[i];
+        }
+        return sum;
+    }
+    
+    double percent(WorkerState state) const {
+        ULONGLONG sum = total();
+        return sum > 0 ? cycles[state] * 100.0 / sum : 0.0;
+    }
+};
+
+#endif
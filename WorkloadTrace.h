@@ -0,0 +1,212 @@
+#ifndef WORKLOAD_TRACE_H
+#define WORKLOAD_TRACE_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// one task of a recorded workload - what the simulator needs to replay it
+struct WorkloadRecord {
+    LONGLONG submitUs;    // since the trace started
+    LONGLONG durationUs;  // run time
+    LONGLONG deadlineUs;  // relative to submit, 0 = none
+    int priority;
+    int tenantId;
+};
+
+// workload recorder and file format - attach with scheduler.setRecorder(&trace) to capture
+// production traffic, save() it, and load() it into a SimScheduler to replay offline
+// recording is one interlocked compare-exchange per finished task; when full, further tasks are
+// dropped (counted separately, so recording indefinitely never wraps a slot index)
+// file format is text, one task per line: submit_us duration_us deadline_us priority tenant
+class WorkloadTrace {
+private:
+    WorkloadRecord* records;
+    LONG capacity;
+    volatile LONG next;         // slots handed out, never past capacity
+    volatile LONGLONG dropped;  // tasks not recorded because the trace was full
+    LARGE_INTEGER frequency;
+    LONGLONG baseTicks;
+    
+    LONGLONG toUs(LONGLONG ticks) const {
+        return ticks * 1000000 / frequency.QuadPart;
+    }
+    
+    // stable bottom-up merge sort by submit time - recorded in finish order, which is nearly sorted
+    void sortBySubmit(LONG count) {
+        WorkloadRecord* buffer = new WorkloadRecord[count > 0 ? count : 1];
+        WorkloadRecord* from = records;
+        WorkloadRecord* to = buffer;
+        for (LONG width = 1; width < count; width *= 2) {
+            for (LONG lo = 0; lo < count; lo += 2 * width) {
+                LONG mid = lo + width < count ? lo + width : count;
+                LONG hi = lo + 2 * width < count ? lo + 2 * width : count;
+                LONG a = lo, b = mid, out = lo;
+                while (a < mid && b < hi) {
+                    to[out++] = from[b].submitUs < from[a].submitUs ? from[b++] : from[a++];
+                }
+                while (a < mid) to[out++] = from[a++];
+                while (b < hi) to[out++] = from[b++];
+            }
+            WorkloadRecord* swap = from;
+            from = to;
+            to = swap;
+        }
+        if (from != records) {
+            for (LONG i = 0; i < count; i++) {
+                records[i] = from[i];
+            }
+        }
+        delete[] buffer;
+    }
+    
+    // claim the next slot, -1 once the trace is full
+    LONG claimSlot() {
+        LONG current = next;
+        while (current < capacity) {
+            LONG seen = InterlockedCompareExchange(&next, current + 1, current);
+            if (seen == current) return current;
+            current = seen;
+        }
+        InterlockedIncrement64(&dropped);
+        return -1;
+    }
+    
+    static void write(HANDLE file, const char* text, int length) {
+        DWORD written;
+        WriteFile(file, text, (DWORD)length, &written, NULL);
+    }
+    
+public:
+    WorkloadTrace(LONG maxRecords = 1 << 20) : capacity(maxRecords), next(0), dropped(0) {
+        records = new WorkloadRecord[capacity];
+        QueryPerformanceFrequency(&frequency);
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        baseTicks = now.QuadPart;
+    }
+    
+    ~WorkloadTrace() {
+        delete[] records;
+    }
+    
+    WorkloadTrace(const WorkloadTrace&) = delete;
+    WorkloadTrace& operator=(const WorkloadTrace&) = delete;
+    
+    // a finished task (QPC ticks) - called by the scheduler from any worker
+    void record(LONGLONG enqueueTicks, LONGLONG startTicks, LONGLONG endTicks, int priority, int tenantId,
+                LONGLONG deadlineTicks) {
+        LONG slot = claimSlot();
+        if (slot < 0) return;
+        
+        WorkloadRecord& r = records[slot];
+        r.submitUs = toUs(enqueueTicks - baseTicks);
+        r.durationUs = toUs(endTicks - startTicks);
+        r.deadlineUs = deadlineTicks != 0 ? toUs(deadlineTicks - enqueueTicks) : 0;
+        r.priority = priority;
+        r.tenantId = tenantId;
+    }
+    
+    // append a synthetic task (building a workload by hand)
+    bool add(const WorkloadRecord& r) {
+        LONG slot = claimSlot();
+        if (slot < 0) return false;
+        records[slot] = r;
+        return true;
+    }
+    
+    LONG size() const {
+        return next;
+    }
+    
+    const WorkloadRecord& get(LONG index) const {
+        return records[index];
+    }
+    
+    // tasks not recorded because the trace was full
+    LONGLONG getDropped() const {
+        return dropped;
+    }
+    
+    void clear() {
+        next = 0;
+        dropped = 0;
+    }
+    
+    // write the trace sorted by submit time - stop recording (or the load) first
+    bool save(const char* path) {
+        HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        LONG count = size();
+        sortBySubmit(count);
+        
+        char line[160];
+        int n = sprintf_s(line, "# workload trace: submit_us duration_us deadline_us priority tenant\n");
+        write(file, line, n);
+        for (LONG i = 0; i < count; i++) {
+            const WorkloadRecord& r = records[i];
+            n = sprintf_s(line, "%lld %lld %lld %d %d\n", r.submitUs, r.durationUs, r.deadlineUs, r.priority, r.tenantId);
+            write(file, line, n);
+        }
+        
+        CloseHandle(file);
+        return true;
+    }
+    
+    // replace the contents with a saved trace - false if the file cannot be read
+    bool load(const char* path) {
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart > 0x7FFFFFFF) {
+            CloseHandle(file);
+            return false;
+        }
+        
+        DWORD length = (DWORD)fileSize.QuadPart;
+        char* text = new char[length + 1];
+        DWORD read = 0;
+        BOOL ok = ReadFile(file, text, length, &read, NULL);
+        CloseHandle(file);
+        if (!ok) {
+            delete[] text;
+            return false;
+        }
+        text[read] = '\0';
+        
+        clear();
+        char* cursor = text;
+        while (*cursor != '\0') {
+            char* end = cursor;
+            while (*end != '\0' && *end != '\n') end++;
+            bool last = *end == '\0';
+            *end = '\0';
+            
+            if (*cursor != '#' && *cursor != '\0' && *cursor != '\r') {
+                WorkloadRecord r;
+                char* p = cursor;
+                r.submitUs = _strtoi64(p, &p, 10);
+                r.durationUs = _strtoi64(p, &p, 10);
+                r.deadlineUs = _strtoi64(p, &p, 10);
+                r.priority = (int)strtol(p, &p, 10);
+                r.tenantId = (int)strtol(p, &p, 10);
+                if (!add(r)) break;
+            }
+            
+            if (last) break;
+            cursor = end + 1;
+        }
+        
+        delete[] text;
+        sortBySubmit(size());
+        return true;
+    }
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include <iostream>
+#include "IoReactor.h"  // first - winsock2.h must precede windows.h
 #include <windows.h>
 #include "TaskScheduler.h"
 #include "Logger.h"
@@ -71,6 +72,352 @@ int Fibonacci(void* arg) {
     return b;
 }
 
+// keyed check - raise keyed tasks' priority while the queue is full, under each overflow policy
+// whatever the policy does with the original submission, no entry may run twice and nothing
+// may stay counted as pending or queued
+const int KEYED_CHECK_KEYS = 64;
+const int KEYED_CHECK_ROUNDS = 20000;
+
+struct KeyedCheck {
+    TaskScheduler* scheduler;
+    volatile LONG* runs;  // one counter per submission - merged ones never run
+    volatile LONG stop;
+};
+
+void KeyedCheckTask(void* arg) {
+    InterlockedIncrement((volatile LONG*)arg);
+}
+
+void KeyedCheckFiller(void*) {
+    Sleep(0);
+}
+
+DWORD WINAPI KeyedCheckRaiser(LPVOID param) {
+    KeyedCheck* check = (KeyedCheck*)param;
+    int next = KEYED_CHECK_ROUNDS;
+    while (!check->stop && next < 2 * KEYED_CHECK_ROUNDS) {
+        check->scheduler->enqueueKeyed(next % KEYED_CHECK_KEYS, KeyedCheckTask, (void*)&check->runs[next], CRITICAL);
+        next++;
+    }
+    return 0;
+}
+
+bool CheckKeyedRaiseWhileFull(OverflowPolicy policy) {
+    TaskScheduler scheduler(2);
+    scheduler.setCapacity(8, policy);
+    
+    KeyedCheck check;
+    check.scheduler = &scheduler;
+    check.runs = new LONG[2 * KEYED_CHECK_ROUNDS]();
+    check.stop = 0;
+    
+    HANDLE raiser = CreateThread(NULL, 0, KeyedCheckRaiser, &check, 0, NULL);
+    for (int i = 0; i < KEYED_CHECK_ROUNDS; i++) {
+        scheduler.tryEnqueueTask(KeyedCheckFiller, nullptr, MEDIUM);
+        scheduler.enqueueKeyed(i % KEYED_CHECK_KEYS, KeyedCheckTask, (void*)&check.runs[i], LOW);
+    }
+    check.stop = 1;
+    WaitForSingleObject(raiser, INFINITE);
+    CloseHandle(raiser);
+    
+    while (scheduler.getMetrics().getPendingTasks() > 0) {
+        Sleep(10);
+    }
+    
+    LONG doubleRuns = 0;
+    for (int i = 0; i < 2 * KEYED_CHECK_ROUNDS; i++) {
+        if (check.runs[i] > 1) doubleRuns++;
+    }
+    LONG queued = 0;
+    for (int level = 0; level < PRIORITY_LEVELS; level++) {
+        queued += scheduler.getMetrics().getQueueDepth(level);
+    }
+    delete[] check.runs;
+    
+    char msg[160];
+    sprintf_s(msg, "Keyed raise on a full queue (policy %d): %ld double runs, %ld left queued",
+              (int)policy, doubleRuns, queued);
+    if (doubleRuns == 0 && queued == 0) {
+        globalLogger.success(msg);
+        return true;
+    }
+    globalLogger.error(msg);
+    return false;
+}
+
+// profiler check - a fork-join tree where every parent joins its children with Future::get()
+// on a worker, running queued tasks nested while it waits; each task must be charged only its
+// own time, so the profiled run time cannot exceed the time the workers had
+struct ForkJoinCheckArgs {
+    TaskScheduler* scheduler;
+    int depth;
+    Future<int>* done;
+    
+    ForkJoinCheckArgs(TaskScheduler* s, int d, Future<int>* f) : scheduler(s), depth(d), done(f) {}
+};
+
+void ForkJoinCheckTask(void* param) {
+    ForkJoinCheckArgs* args = (ForkJoinCheckArgs*)param;
+    
+    // ~100 us of work of its own
+    LARGE_INTEGER frequency, start, now;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    do {
+        QueryPerformanceCounter(&now);
+    } while ((now.QuadPart - start.QuadPart) * 10000 < frequency.QuadPart);
+    
+    if (args->depth > 0) {
+        Future<int> left, right;
+        args->scheduler->enqueueTask(ForkJoinCheckTask, new ForkJoinCheckArgs(args->scheduler, args->depth - 1, &left));
+        args->scheduler->enqueueTask(ForkJoinCheckTask, new ForkJoinCheckArgs(args->scheduler, args->depth - 1, &right));
+        left.get();   // runs other queued forks while waiting
+        right.get();
+    }
+    
+    Future<int>* done = args->done;
+    delete args;
+    done->setResult(1);
+}
+
+bool CheckForkJoinProfile() {
+    const int THREADS = 4;
+    TaskProfiler profiler;
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    {
+        TaskScheduler scheduler(THREADS);
+        scheduler.setProfiler(&profiler);
+        
+        QueryPerformanceCounter(&start);
+        Future<int> root;
+        scheduler.enqueueTask(ForkJoinCheckTask, new ForkJoinCheckArgs(&scheduler, 9, &root));
+        root.get();
+        QueryPerformanceCounter(&end);
+    }  // joined - the root's own record is in
+    double workerMs = THREADS * (double)(end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+    
+    TaskTypeStats stats[4];
+    int types = profiler.getTop(stats, 4);
+    double profiledMs = 0;
+    LONGLONG calls = 0;
+    for (int i = 0; i < types; i++) {
+        profiledMs += stats[i].runMs;
+        calls += stats[i].calls;
+    }
+    double share = workerMs > 0 ? profiledMs * 100.0 / workerMs : 0;
+    
+    char msg[160];
+    sprintf_s(msg, "Fork-join profile: %lld tasks, profiled run time %.0f%% of worker time", calls, share);
+    if (share > 50.0 && share <= 105.0) {
+        globalLogger.success(msg);
+        return true;
+    }
+    globalLogger.error(msg);
+    return false;
+}
+
+// I/O checks - the reactor against a local file, a named pipe and loopback sockets, and
+// completions arriving while the queue is full (they must neither stall the port thread nor
+// run on it, nor be evicted or shed once queued)
+bool ReportIoCheck(const char* name, bool passed, const char* detail) {
+    char msg[192];
+    sprintf_s(msg, "I/O %s: %s", name, detail);
+    if (passed) {
+        globalLogger.success(msg);
+    } else {
+        globalLogger.error(msg);
+    }
+    return passed;
+}
+
+// wait for an I/O future and free it
+IoResult TakeIoResult(Future<IoResult>* future) {
+    IoResult result = future->get();
+    if (future->getState() != FUTURE_READY) {
+        result = IoResult(0, ERROR_OPERATION_ABORTED);
+    }
+    delete future;
+    return result;
+}
+
+bool CheckIoFile(IoReactor<TaskScheduler>& reactor) {
+    char dir[MAX_PATH], path[MAX_PATH];
+    GetTempPathA(MAX_PATH, dir);
+    GetTempFileNameA(dir, "tsk", 0, path);
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                              FILE_FLAG_OVERLAPPED | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE || !reactor.associate(file)) {
+        return ReportIoCheck("file", false, "could not open a temporary file");
+    }
+    
+    const char text[] = "overlapped file payload";
+    char buffer[64] = {};
+    IoResult written = TakeIoResult(reactor.write(file, text, sizeof(text), 4096));
+    IoResult read = TakeIoResult(reactor.read(file, buffer, sizeof(buffer), 4096));
+    IoResult end = TakeIoResult(reactor.read(file, buffer + 32, 16, 1 << 20));
+    CloseHandle(file);
+    
+    bool passed = written.ok() && written.bytes == sizeof(text) && read.ok() && read.bytes == sizeof(text) &&
+                  memcmp(buffer, text, sizeof(text)) == 0 && end.error == ERROR_HANDLE_EOF;
+    return ReportIoCheck("file", passed, passed ? "write/read at an offset and EOF past the end"
+                                                : "data or EOF mismatch");
+}
+
+bool CheckIoPipe(IoReactor<TaskScheduler>& reactor) {
+    char name[64];
+    sprintf_s(name, "\\\\.\\pipe\\TaskSchedulerCheck-%lu", GetCurrentProcessId());
+    HANDLE server = CreateNamedPipeA(name, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+                                     PIPE_TYPE_BYTE | PIPE_WAIT, 1, 4096, 4096, 0, NULL);
+    HANDLE client = CreateFileA(name, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, NULL);
+    if (server == INVALID_HANDLE_VALUE || client == INVALID_HANDLE_VALUE) {
+        if (server != INVALID_HANDLE_VALUE) CloseHandle(server);
+        return ReportIoCheck("pipe", false, "could not create the pipe");
+    }
+    
+    // the client is already in - the connect completes at once (before the port sees the handle)
+    OVERLAPPED connect = {};
+    if (!ConnectNamedPipe(server, &connect) && GetLastError() != ERROR_PIPE_CONNECTED) {
+        CloseHandle(client);
+        CloseHandle(server);
+        return ReportIoCheck("pipe", false, "connect failed");
+    }
+    reactor.associate(server);
+    reactor.associate(client);
+    
+    const char text[] = "named pipe payload";
+    char buffer[64] = {};
+    Future<IoResult>* pendingRead = reactor.read(server, buffer, sizeof(buffer));  // in flight before the write
+    IoResult written = TakeIoResult(reactor.write(client, text, sizeof(text)));
+    IoResult read = TakeIoResult(pendingRead);
+    CloseHandle(client);
+    CloseHandle(server);
+    
+    bool passed = written.ok() && read.ok() && read.bytes == sizeof(text) && memcmp(buffer, text, sizeof(text)) == 0;
+    return ReportIoCheck("pipe", passed, passed ? "pending read completed by the peer's write" : "data mismatch");
+}
+
+bool CheckIoSocket(IoReactor<TaskScheduler>& reactor) {
+    SOCKET listener = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    SOCKET accepted = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    SOCKET client = WSASocket(AF_INET, SOCK_STREAM, IPPROTO_TCP, NULL, 0, WSA_FLAG_OVERLAPPED);
+    
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    int length = sizeof(address);
+    bool ready = listener != INVALID_SOCKET && accepted != INVALID_SOCKET && client != INVALID_SOCKET &&
+                 bind(listener, (sockaddr*)&address, sizeof(address)) == 0 && listen(listener, 1) == 0 &&
+                 getsockname(listener, (sockaddr*)&address, &length) == 0 && reactor.associate(listener);
+    
+    bool passed = false;
+    if (ready) {
+        Future<IoResult>* acceptFuture = reactor.accept(listener, accepted);
+        bool connected = connect(client, (sockaddr*)&address, sizeof(address)) == 0;
+        IoResult acceptResult = TakeIoResult(acceptFuture);
+        
+        if (connected && acceptResult.ok()) {
+            reactor.associate(accepted);
+            reactor.associate(client);
+            
+            const char text[] = "loopback socket payload";
+            char buffer[64] = {};
+            Future<IoResult>* pendingRead = reactor.read(accepted, buffer, sizeof(buffer));
+            IoResult written = TakeIoResult(reactor.write(client, text, sizeof(text)));
+            IoResult read = TakeIoResult(pendingRead);
+            passed = written.ok() && read.ok() && read.bytes == sizeof(text) && memcmp(buffer, text, sizeof(text)) == 0;
+        }
+    }
+    
+    if (client != INVALID_SOCKET) closesocket(client);
+    if (accepted != INVALID_SOCKET) closesocket(accepted);
+    if (listener != INVALID_SOCKET) closesocket(listener);
+    return ReportIoCheck("socket", passed, passed ? "accept, then a pending read completed by the peer" : "accept or data failed");
+}
+
+// which kind of thread completed an I/O future (continuation context)
+struct IoCompletionThread {
+    TaskScheduler* scheduler;
+    volatile LONG onWorker;
+    volatile LONG offWorker;
+};
+
+void RecordIoCompletionThread(void* context) {
+    IoCompletionThread* record = (IoCompletionThread*)context;
+    InterlockedIncrement(record->scheduler->isWorkerThread() ? &record->onWorker : &record->offWorker);
+}
+
+HANDLE ioCheckGate;
+
+void IoCheckBlocker(void*) {
+    WaitForSingleObject(ioCheckGate, INFINITE);
+}
+
+bool CheckIoFullQueue(OverflowPolicy policy) {
+    const int TIMERS = 8;
+    TaskScheduler scheduler(1);
+    scheduler.setCapacity(1, policy);
+    scheduler.setMaxQueueWait(LOW, 20);  // the completions wait longer - they must not be shed
+    IoReactor<TaskScheduler> reactor(&scheduler);
+    
+    // the worker is held and the one slot taken - every completion finds the queue full
+    ioCheckGate = CreateEvent(NULL, TRUE, FALSE, NULL);
+    scheduler.enqueueTask(IoCheckBlocker, nullptr, CRITICAL);
+    while (scheduler.getMetrics().getQueueDepth(CRITICAL) > 0) {
+        Sleep(1);
+    }
+    scheduler.tryEnqueueTask(KeyedCheckFiller, nullptr, LOW);
+    
+    IoCompletionThread record = { &scheduler, 0, 0 };
+    Future<IoResult>* timers[TIMERS];
+    for (int i = 0; i < TIMERS; i++) {
+        timers[i] = reactor.after(1 + i, LOW);
+        timers[i]->onReady(RecordIoCompletionThread, &record);
+    }
+    
+    // all completions are queued (behind the filler) while the port thread keeps going
+    Sleep(100);
+    LONG queued = scheduler.getMetrics().getQueueDepth(LOW) - 1;
+    
+    // new LOW work makes room by evicting the oldest LOW task - never a completion
+    if (policy == OVERFLOW_DROP_OLDEST_LOW) {
+        for (int i = 0; i <= TIMERS; i++) {
+            scheduler.tryEnqueueTask(KeyedCheckFiller, nullptr, LOW);
+        }
+    }
+    
+    SetEvent(ioCheckGate);
+    LONG delivered = 0;
+    for (int i = 0; i < TIMERS; i++) {
+        if (TakeIoResult(timers[i]).ok()) delivered++;
+    }
+    // continuations run just after the waiters are released
+    for (int spins = 0; record.onWorker + record.offWorker < TIMERS && spins < 1000; spins++) {
+        Sleep(1);
+    }
+    CloseHandle(ioCheckGate);
+    
+    char detail[160];
+    bool passed = queued == TIMERS && delivered == TIMERS && record.onWorker == TIMERS && record.offWorker == 0;
+    sprintf_s(detail, "full queue (policy %d): %ld of %d completions queued, %ld delivered, %ld completed off the workers",
+              (int)policy, queued, TIMERS, delivered, record.offWorker);
+    return ReportIoCheck("completions", passed, detail);
+}
+
+void RunIoChecks() {
+    {
+        TaskScheduler scheduler(2);
+        IoReactor<TaskScheduler> reactor(&scheduler);
+        CheckIoFile(reactor);
+        CheckIoPipe(reactor);
+        CheckIoSocket(reactor);
+    }
+    CheckIoFullQueue(OVERFLOW_BLOCK);
+    CheckIoFullQueue(OVERFLOW_CALLER_RUNS);
+    CheckIoFullQueue(OVERFLOW_DROP_OLDEST_LOW);
+}
+
 int main() {
     globalLogger.info("=== TaskScheduler with Future/Promise Pattern ===");
     
@@ -83,6 +430,13 @@ int main() {
     globalLogger.info("Creating scheduler with 3 worker threads...");
     TaskScheduler scheduler(3);
     globalLogger.success("Scheduler created successfully!");
+    
+    // per task type run time / queue wait, printed with the metrics
+    TaskProfiler profiler;
+    profiler.setLabel((void*)CalculateFactorial, "CalculateFactorial");
+    profiler.setLabel((void*)SumOfSquares, "SumOfSquares");
+    profiler.setLabel((void*)Fibonacci, "Fibonacci");
+    scheduler.setProfiler(&profiler);
     std::cout << std::endl;
     
     // dynamic allocation for task arguments - no hardcoded limits
@@ -154,6 +508,16 @@ int main() {
     std::cout << std::endl;
     globalLogger.info("=== FINAL METRICS ===");
     scheduler.getMetrics().printStats();
+    profiler.printTop(5);
+    
+    // ========== FEATURE CHECKS ==========
+    std::cout << std::endl;
+    globalLogger.info("=== Feature checks ===");
+    CheckKeyedRaiseWhileFull(OVERFLOW_BLOCK);
+    CheckKeyedRaiseWhileFull(OVERFLOW_REJECT);
+    CheckKeyedRaiseWhileFull(OVERFLOW_CALLER_RUNS);
+    CheckForkJoinProfile();
+    RunIoChecks();
     
     // ========== BENCHMARK SUITE ==========
     std::cout << "\n\n";
@@ -190,6 +554,27 @@ int main() {
     std::cout << std::endl;
     benchmark.benchmarkPriorities(4, 100);
     
+    Sleep(1000); // pause between benchmarks
+    
+    // benchmark 4: idle strategy wake-up latency
+    globalLogger.warning(">>> BENCHMARK 4: Idle Strategy Wake-Up Latency <<<");
+    std::cout << std::endl;
+    benchmark.benchmarkIdleStrategies(4, 200);
+    
+    Sleep(1000); // pause between benchmarks
+    
+    // benchmark 5: scheduling policies
+    globalLogger.warning(">>> BENCHMARK 5: Scheduling Policies <<<");
+    std::cout << std::endl;
+    benchmark.benchmarkPolicies(4, 2000);
+    
+    Sleep(1000); // pause between benchmarks
+    
+    // benchmark 6: nested fork-join on a small pool
+    globalLogger.warning(">>> BENCHMARK 6: Nested Fork-Join <<<");
+    std::cout << std::endl;
+    benchmark.benchmarkForkJoin(3, 32);
+    
     // summary
     std::cout << std::endl;
     globalLogger.success("========================================");